@@ -17,17 +17,38 @@
  *
  * Compile:
  *
- *      gcc cache-sim.c -o cache-sim
+ *      gcc cache-sim.c -o cache-sim -pthread
  *
  * Run:
  *
  *      ./cache-sim [-<line-size>] [{-OPTION <value>}] < <filename>
+ *      ./cache-sim [-<line-size>] [{-OPTION <value>}] {-t <filename>}
+ *      ./cache-sim [-<line-size>] -c <protocol> [{-OPTION <value>}] < <filename>
  *
  * Options:
  *
  *      -s  - specify the cache size (in KB), default 32 KB
  *      -b  - specify the number of cache banks, default 8-way
  *      -l  - specify the line size (in bytes), default 64 bytes
+ *      -i  - specify the set index function, default bit
+ *      -k  - specify the hash matrix seed (h3, skew), default 1
+ *      -r  - print the miss ratio curve, sampling 1 in r blocks
+ *      -m  - specify the max sampled blocks, at least 8192, default unbounded
+ *      --profile - print the time of each simulation phase
+ *      -t  - specify the trace file of a core (repeatable)
+ *      -S  - specify the shared cache size (in KB), default 1024 KB
+ *      -B  - specify the number of shared cache banks, default 16-way
+ *      -w  - specify the shared cache way mask of a core (hex, repeatable)
+ *      -u  - repartition the shared cache every u accesses (UCP)
+ *      -o  - interleave the cores rr (round-robin) or ts (timestamp)
+ *      -c  - simulate coherent caches by mesi or moesi
+ *      -n  - specify the number of coherent cores, default 4
+ *      -Q  - time the references with Q MSHRs, default untimed
+ *      -H  - specify the hit latency (in cycles), default 4
+ *      -M  - specify the miss latency (in cycles), default 100
+ *      -W  - specify the next level bandwidth (in B/cycle), default unlimited
+ *      -I  - specify the cycles between references, default 1
+ *      -e  - specify the sector size (in bytes), default unsectored
  *
  * Benchmark File:
  *
@@ -88,7 +109,97 @@
  *
  *      - All specfied cache specification values are required to be some
  *        power of two, such that log_2(value) is an integer, otherwise
- *        the default value is used.
+ *        the default value is used. The mod and prime index functions
+ *        use every line per bank, so that non power of two bank counts
+ *        (i.e.: -b 12) index all of their sets.
+ *
+ *      - The set index functions (-i) are:
+ *
+ *              bit     - bit-select, the low block address bits
+ *              xor     - xor-fold of the whole block address
+ *              h3      - H3 hash matrix, seeded by -k
+ *              mod     - block address modulo the lines per bank
+ *              prime   - block address modulo the largest prime number
+ *                        of lines per bank
+ *              skew    - skewed-associative, an H3 matrix per bank
+ *
+ *        With a non power of two number of lines per bank, the bit, xor,
+ *        h3, and skew functions reduce their hash modulo the lines per
+ *        bank, so that every set is indexed. The modulo uses a precomputed
+ *        multiply-shift reciprocal instead of a division.
+ *
+ *      - The miss ratio curve (-r, -m) of a fully-associative LRU cache
+ *        with the specified line size is approximated by hash sampling the
+ *        block addresses (SHARDS) and tracking the reuse distances of the
+ *        sampled blocks only. A fixed rate (-r) samples 1 in r blocks, and
+ *        -r 1 gives the exact curve. A max number of sampled blocks (-m)
+ *        of at least 8192 bounds the memory, lowering the sampling rate as
+ *        needed. A sampled curve starts at 512 sampling intervals, and a
+ *        fixed rate needs at least 8192 sampled blocks, as the few sampled
+ *        hot blocks skew smaller sizes and samples by several percent.
+ *        mrc-check.sh checks the exact and sampled curves against
+ *        fully-associative simulations, failing if off by more than 0.01.
+ *
+ *      - The simulation phases (trace parse, index/tag, hit_search, victim,
+ *        and output) are timed with the time stamp counter on 1 in 64
+ *        references (--profile), and the host hardware counters (cycles,
+ *        instructions, LLC misses, branch misses) are read where the
+ *        perf_event_open system call is permitted. The phase times,
+ *        references/second, and ns/reference are printed with the stats.
+ *        Only the single cache simulation is profiled, not -t, -c or -r.
+ *
+ *      - Each trace file (-t) is simulated on its own core with a private
+ *        cache of the specified size, banks, and line size. The private
+ *        cache misses of all cores go to one shared cache (-S, -B). The
+ *        traces are read in parallel, one reader thread per core, and
+ *        merged round-robin or by timestamp (-o ts, lines of
+ *        "<timestamp> <address>" with a decimal timestamp).
+ *
+ *      - The shared cache may be way partitioned by a static hex mask per
+ *        core (-w, in core order, as with CAT), or by utility-based cache
+ *        partitioning (-u), repartitioning every u shared cache accesses
+ *        from per core UMON hit counters of every 32nd set. Hits may be
+ *        in any bank, and a miss replaces the oldest line of the banks in
+ *        the mask of the core. The masks cover up to 32 banks, so -w and
+ *        -u require a shared cache of at most 32 banks.
+ *
+ *      - The report gives the private and shared cache hit rates of each
+ *        core, the lines of the core evicted by other cores, and the lines
+ *        of other cores it evicted.
+ *
+ *      - The coherent caches (-c) read a trace of "<thread> <R|W> <address>"
+ *        lines, running thread t on core t mod n (-n). Each core has a
+ *        private cache of the specified size, banks, and line size, kept
+ *        coherent by a MESI (or MOESI) snoop protocol. The other caches
+ *        are only snooped on misses and on writes to S or O lines.
+ *
+ *      - A miss to a line that another core invalidated is a coherence
+ *        miss. It is a false sharing miss if no other core wrote the same
+ *        granule of the line (4 bytes, or 1/32 of the line if larger),
+ *        and the lines with the most false sharing misses are reported.
+ *
+ *      - The timing model (-Q) issues a reference every I cycles (-I) on a
+ *        non-blocking cache. A hit takes H cycles (-H). A miss takes an
+ *        MSHR for M cycles (-M), or longer if the next level bandwidth
+ *        (-W) is busy, and the issue stalls while every MSHR is busy. A
+ *        hit to a line still being filled is a secondary miss merged into
+ *        its MSHR. The cycles, average latency, memory-level parallelism,
+ *        and stall cycles are printed with the stats. The model only does
+ *        work per miss, not per simulated cycle. The timing options (-Q,
+ *        -H, -M, -W, -I) are rejected with -t, -c and -r.
+ *
+ *      - Sectored lines (-e) keep one tag per line of the line size (-l),
+ *        divided into at most 32 sectors of the sector size, each with a
+ *        valid and a dirty bit packed into bitmasks of the line. A tag
+ *        miss fills only the sector of the address, and a tag hit missing
+ *        its sector is a sector miss filling it. The address may be
+ *        followed by a r or w flag (i.e.: "0000202c w") marking the
+ *        sector dirty, and dirty sectors are written back on
+ *        replacement. Without -e the flag is read and ignored, so the
+ *        same trace runs sectored and unsectored. The tag misses, sector
+ *        misses, bytes fetched, and bytes written back are printed with
+ *        the stats. The timing model (-Q) fills and transfers one sector
+ *        per miss. Sectors are rejected with -t, -c and -r.
  *
  *      - The default cache is a 32 KB 8-way set-associative cache with
  *        64 lines per bank (set) and a line size of 64 bytes.
@@ -131,30 +242,118 @@ int main(int argc, char *argv[])
     printf("cache specs:\n\n");
     print_spec(spec);
 
+    // simulate a private cache per core trace sharing a last level cache
+    if (spec.cores > 0)
+    {
+        struct spec shared = spec;
+        shared.size = spec.llcsize;
+        shared.banks = spec.llcbanks;
+        shared.lines = shared.size/(shared.banks*shared.bytes);
+        shared.offset = log_2(shared.lines);
+        printf("shared cache specs:\n\n");
+        print_spec(shared);
+
+        struct cache *llc = init_cache(shared);
+        struct core *cores = init_cores(spec, llc);
+        sim_cores(spec, cores, llc);
+        printf("per core cache data:\n\n");
+        print_cores(cores, spec.cores, llc);
+        free_cores(cores, spec.cores);
+        free_cache(llc);
+        free(spec.traces);
+        free(spec.masks);
+        return 0;
+    }
+
+    // simulate coherent private caches of a thread tagged trace
+    if (spec.protocol > 0)
+    {
+        struct coherence *coh = init_coherence(spec);
+        int thread = 0;                 // temp thread id
+        char rw = 0;                    // temp read/write flag
+        int address = 0;                // temp address
+        while(scanf("%d %c %x", &thread, &rw, &address) == 3)
+            coh_access(coh, (thread % spec.cpus + spec.cpus) % spec.cpus,
+                    rw == 'W' || rw == 'w', address);
+        printf("coherent cache data:\n\n");
+        print_coherence(coh);
+        free_coherence(coh);
+        free(spec.traces);
+        free(spec.masks);
+        return 0;
+    }
+
+    // approximate the miss ratio curve instead of simulating the cache
+    if (spec.rate > 0)
+    {
+        struct mrc *mrc = init_mrc(spec);
+        int address = 0;                // temp address
+        while(scanf("%x", &address) != EOF)
+        {
+            read_rw();
+            mrc_access(mrc, address);
+        }
+        printf("miss ratio curve:\n\n");
+        print_mrc(mrc, spec.bytes);
+        free_mrc(mrc);
+        free(spec.traces);
+        free(spec.masks);
+        return 0;
+    }
+
+    // precompute the set index function
+    struct hash *hash = init_hash(spec);
+    print_hash(hash);
+
     // allocate and initialize cache line arrays
     struct line *line = init_line(spec.banks, spec.lines);
+    if (spec.sector > 0)
+        init_sectors(spec, line);
 
     // initialize cache simulation data
     struct data data;
     init_data(&data);
+    if (spec.hash == HSKW)
+        data.sets = init_array(spec.banks);
     printf("initial cache data:\n\n");
     print_data(data);
 
+    // time the references on a non-blocking cache
+    struct timing *tim = (spec.mshrs > 0) ? init_timing(spec) : NULL;
+
+    // sample the phase times of the simulation
+    struct prof *prof = init_prof(spec);
+    if (spec.profile)
+        prof_start(prof);
+
     // read input file lines as cache memory addresses
     int address = 0;                    // temp address
+    int write = 0;                      // temp read/write flag
     while(scanf("%x", &address) != EOF)
     {
+        write = read_rw();
+        prof_mark(prof, PPARSE);
         data.address = address;
         data.access++;
-        data.index = (data.address >> (AIO - spec.offset)) & (spec.lines-1);
-        data.tag = data.address >> (ATO - spec.offset);
+        hash_address(hash, &data);
+        prof_mark(prof, PINDEX);
 
         // search for hit
         data.bank = hit_search(spec, data, line);
-        if(data.bank != -1)
+        int hit = (data.bank != -1);
+        if (hit && spec.sector > 0)
+            hit = sec_search(&data, line);
+        prof_mark(prof, PHIT);
+        if(hit)
         {
             data.hits++;
-            line[data.bank].lastused[data.index] = data.access;
+            line[data.bank].lastused[SET(data, data.bank)] = data.access;
+        }
+        else if(data.bank != -1)
+        {
+            // sector miss, filled by sec_search
+            data.misses++;
+            line[data.bank].lastused[SET(data, data.bank)] = data.access;
         }
         else
         {
@@ -167,18 +366,41 @@ int main(int argc, char *argv[])
                 data.bank = old_search(spec, data, line);
 
             // use previously invalid line or oldest
-            line[data.bank].valid[data.index] = 1;
-            line[data.bank].tag[data.index] = data.tag;
-            line[data.bank].lastused[data.index] = data.access;
+            if (spec.sector > 0)
+                sec_fill(&data, line);
+            line[data.bank].valid[SET(data, data.bank)] = 1;
+            line[data.bank].tag[SET(data, data.bank)] = data.tag;
+            line[data.bank].lastused[SET(data, data.bank)] = data.access;
         }
+        if (write && spec.sector > 0)
+            sec_write(&data, line);
+        if (tim != NULL)
+            tim_access(tim, hit, data.address);
+        prof_mark(prof, PVICTIM);
         print_data(data);
+        prof_mark(prof, POUTPUT);
+        prof_next(prof);
     }
+    if (spec.profile)
+        prof_stop(prof);
 
     // display stats
     printf("final cache data:\n\n");
     print_data(data);
     printf("cache hit rate:\n\n");
     print_stats(data.hits, data.misses);
+    if (spec.sector > 0)
+    {
+        printf("cache sectors:\n\n");
+        print_sectors(spec, data);
+    }
+    if (tim != NULL && tim->refs > 0)
+    {
+        printf("cache timing:\n\n");
+        print_timing(tim);
+    }
+    if (spec.profile && prof->refs > 0)
+        print_prof(prof);
 
     // free allocated memory
     int i;
@@ -187,8 +409,19 @@ int main(int argc, char *argv[])
         free(line[i].lastused);
         free(line[i].valid);
         free(line[i].tag);
+        free(line[i].owner);
+        free(line[i].present);
+        free(line[i].dirty);
     }
     free(line);
+    free(data.sets);
+    free(hash->h3);
+    free(hash);
+    free(prof);
+    if (tim != NULL)
+        free_timing(tim);
+    free(spec.traces);
+    free(spec.masks);
     return 0;
 }
 
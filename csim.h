@@ -2,14 +2,84 @@
 /* -- include libraries -- */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 /* -- defined constants -- */
 #define SIZE  32                // max cache size [KB]
 #define KB    1024              // bytes per kilo-byte
 #define LINES 64                // default lines per bank
 #define BANKS 8                 // default banks per cache
-#define AIO   12                // address index shift offset
-#define ATO   18                // address tag shift offset
+#define SEED  1                 // default hash matrix seed
+#define ABITS 32                // address bits
+
+/* -- set index functions -- */
+#define HBIT  0                 // bit-select (low index bits)
+#define HXOR  1                 // xor-fold of the block address
+#define HH3   2                 // H3 hash matrix
+#define HMOD  3                 // modulo the number of lines per bank
+#define HPRM  4                 // modulo the largest prime <= lines per bank
+#define HSKW  5                 // skewed-associative, H3 matrix per bank
+
+/* -- miss ratio curve sampling -- */
+#define MRCP  (1 << 24)         // block hash sampling modulus
+#define MRCB  256               // reuse distance bins
+#define MRCT  1024              // initial sampled block table size
+#define MRCS  8192              // min sampled blocks of an accurate curve
+#define MRCK  512               // smallest accurate size, in sampling intervals
+
+/* -- self-profiling -- */
+#define PSAMP 64                // profile 1 in PSAMP references, on average
+#define PPARSE  0               // trace parse phase
+#define PINDEX  1               // index and tag extraction phase
+#define PHIT    2               // hit search phase
+#define PVICTIM 3               // victim selection and update phase
+#define POUTPUT 4               // output phase
+#define PHASES  5               // profiled phases
+#define PERFS   4               // host hardware counters
+
+/* -- multi-core simulation -- */
+#define CORES   32              // max simulated cores
+#define LLCSIZE 1024            // default shared cache size [KB]
+#define LLCBANKS 16             // default shared cache banks
+#define CHUNK   4096            // references per trace reader chunk
+#define QDEPTH  4               // trace reader chunks per core
+#define UMONS   32              // shared cache sets per UMON sampled set
+#define ORR     0               // interleave cores round-robin
+#define OTS     1               // interleave cores by timestamp
+
+/* -- coherence simulation -- */
+#define CPUS    4               // default coherent cores
+#define CMESI   1               // MESI snoop protocol
+#define CMOESI  2               // MOESI snoop protocol
+#define CI      0               // invalid line state
+#define CS      1               // shared line state
+#define CE      2               // exclusive line state
+#define CO      3               // owned line state (MOESI)
+#define CM      4               // modified line state
+#define GRANS   32              // written granules tracked per line
+#define FSTOP   10              // false sharing lines reported
+#define FSTABLE 1024            // initial false sharing table size
+
+/* -- timing model -- */
+#define HITLAT  4               // default hit latency [cycles]
+#define MISSLAT 100             // default miss latency [cycles]
+
+// set index of the specified bank, per bank for skewed caches
+#define SET(data, i)    ((data).sets ? (data).sets[i] : (data).index)
+
+// the replacement may use the specified bank, banks past 32 are unmasked
+#define WAY(data, i)    ((i) >= 32 || (((data).mask >> (i)) & 1))
 
 /*---------------------------STRUCTURE-DEFINITIONS----------------------------*/
 // cache specifications data
@@ -21,6 +91,26 @@ struct spec
     int lines;          // lines per bank
     int bytes;          // bytes per line (line size)
     int offset;         // instruction tag and index bit offset
+    int hash;           // set index function (HBIT, HXOR, ...)
+    int seed;           // hash matrix seed
+    int rate;           // miss ratio curve sampling rate 1/rate, 0=off
+    int max;            // miss ratio curve max sampled blocks, 0=fixed rate
+    int profile;        // self-profiling, 0=off, 1=on
+    int cores;          // simulated cores, one trace each, 0=stdin only
+    char **traces;      // trace file name per core
+    unsigned int *masks;        // shared cache way mask per core, 0=all
+    int llcsize;        // shared cache size [KB]
+    int llcbanks;       // shared cache banks
+    int ucp;            // utility-based repartition interval, 0=off
+    int order;          // interleave cores (ORR, OTS)
+    int protocol;       // coherence protocol (CMESI, CMOESI), 0=off
+    int cpus;           // coherent cores
+    int mshrs;          // timing model miss status holding registers, 0=off
+    int hitlat;         // timing model hit latency [cycles]
+    int misslat;        // timing model miss latency [cycles]
+    int bandwidth;      // timing model next level bytes/cycle, 0=unlimited
+    int issue;          // timing model cycles between references
+    int sector;         // sector size (in bytes), 0=unsectored lines
 };
 
 // cache simulation data
@@ -33,6 +123,13 @@ struct data
     int hits;           // cache hits counter
     int misses;         // cache misses counter
     int bank;           // current cache bank in use
+    int *sets;          // index bits per bank (skewed), or null
+    unsigned int mask;  // banks the replacement may use
+    int owner;          // core of the current reference
+    int victim;         // core of the replaced line, -1=invalid line
+    unsigned int sector;        // sector bit of the address in its line
+    int sectors;        // sector misses, tag hits missing the sector
+    long long writebacks;       // dirty sectors written back
 };
 
 // cache line flag arrays
@@ -41,11 +138,181 @@ struct line
     int *lastused;      // access count for a given line
     int *valid;         // valid bit for a given line, 0=invalid, 1=valid
     int *tag;           // tag bits for a given line
+    int *owner;         // core that filled a given line
+    unsigned char *state;       // coherence state of a given line, or null
+    unsigned int *words;        // written granules of a given M/O line, or
+                                // the invalidating write of an I line
+    unsigned int *present;      // valid sectors of a given line, or null
+    unsigned int *dirty;        // dirty sectors of a given line, or null
+};
+
+// set index function data
+struct hash
+{
+    int mode;           // set index function (HBIT, HXOR, ...)
+    int banks;          // banks per cache
+    int shift;          // block offset bits == log_2(line size)
+    int sshift;         // sector offset bits == log_2(sector size)
+    int bits;           // hash bits for the bit, xor, and H3 functions
+    int reduce;         // reduce the hash modulo sets, 1 if not a power of two
+    unsigned int sets;  // sets indexed by the function, <= lines per bank
+    unsigned int mask;  // hash bits mask
+    unsigned long long recip;   // multiply-shift reciprocal of sets
+    unsigned int *h3;   // H3 byte lookup tables, 4*256 per matrix
+};
+
+// sampled reuse distance data, for approximate miss ratio curves
+struct mrc
+{
+    int shift;          // block offset bits == log_2(line size)
+    int max;            // max sampled blocks, 0=fixed rate
+    unsigned int threshold;     // sample blocks with hash < threshold
+    int count;          // sampled blocks in the table
+    int capacity;       // table slots, a power of two
+    int bits;           // log_2(capacity)
+    unsigned int *block;        // table block addresses
+    int *time;          // table last access times, -1=empty
+    int size;           // last access time tree size
+    int *tree;          // fenwick tree counting the last access times
+    int clock;          // next last access time
+    long long refs;     // references
+    double hist[MRCB];  // estimated references per reuse distance bin
+    double cold;        // estimated first references to a block
+};
+
+// simulated cache
+struct cache
+{
+    struct spec spec;   // cache specs
+    struct hash *hash;  // set index function
+    struct line *line;  // cache line arrays
+    struct data data;   // cache simulation data
+};
+
+// trace reference
+struct ref
+{
+    unsigned long long time;    // timestamp, or the reference number
+    int address;        // 32-bit address
+};
+
+// trace reader chunk
+struct chunk
+{
+    int n;              // references, < CHUNK at the end of the trace
+    struct ref refs[CHUNK];     // references
+};
+
+// per core trace reader, a ring of chunks filled by a reader thread
+struct trace
+{
+    FILE *file;         // trace file
+    int order;          // interleave cores (ORR, OTS)
+    pthread_t thread;   // reader thread
+    pthread_mutex_t lock;       // ring lock
+    pthread_cond_t cond;        // ring chunk filled or released
+    struct chunk *chunks;       // ring of QDEPTH chunks
+    int head;           // first filled chunk
+    int count;          // filled chunks
+    struct chunk *cur;  // chunk in use by the merge stage, or null
+    int pos;            // next reference in the chunk in use
+};
+
+// simulated core data
+struct core
+{
+    char *name;         // trace file name
+    struct trace trace; // trace reader
+    struct cache *l1;   // private cache
+    struct ref ref;     // next reference
+    int live;           // references remain, 0=end of trace
+    unsigned int mask;  // shared cache way mask
+    long long hits;     // shared cache hits
+    long long misses;   // shared cache misses
+    long long evicted;  // lines of this core evicted by other cores
+    long long evictor;  // lines of other cores evicted by this core
+    long long *umon;    // UMON hits per LRU stack position
+    int *atd;           // UMON tag stacks of the sampled sets, MRU first
+    int *depth;         // UMON valid tags per sampled set
+};
+
+// coherent private caches data
+struct coherence
+{
+    int protocol;       // coherence protocol (CMESI, CMOESI)
+    int n;              // coherent cores
+    int gshift;         // log_2(written granule size)
+    struct cache **caches;      // private cache per core
+    long long reads;    // read references
+    long long writes;   // write references
+    long long upgrades; // writes to S or O lines
+    long long invalidations;    // lines invalidated by other cores
+    long long interventions;    // M or O lines supplied to other cores
+    long long writebacks;       // M or O lines written back
+    long long coherence;        // misses to lines invalidated by other cores
+    long long falses;   // coherence misses to granules others did not write
+    int capacity;       // false sharing table slots, a power of two
+    int count;          // false sharing lines in the table
+    unsigned int *fsblock;      // false sharing line addresses
+    long long *fscount;         // false sharing misses per line, 0=empty
+};
+
+// non-blocking cache timing data
+struct timing
+{
+    int mshrs;          // miss status holding registers
+    int hitlat;         // hit latency [cycles]
+    int misslat;        // miss latency [cycles]
+    int xfer;           // next level cycles per fill, 0=unlimited
+    int issue;          // cycles between references
+    int shift;          // fill offset bits == log_2(fill size)
+    unsigned int *block;        // block of each MSHR
+    long long *ready;   // fill time of each MSHR, <= now if free
+    long long horizon;  // latest fill time of any MSHR
+    long long now;      // issue time of the current reference
+    long long bus;      // time the next level is free
+    long long busy;     // cycles with at least one outstanding miss
+    long long busyend;  // end of the current outstanding miss interval
+    long long misstime; // sum of the outstanding miss cycles
+    long long latency;  // sum of the reference latencies
+    long long stall;    // issue cycles lost to full MSHRs
+    long long refs;     // references
+    long long primary;  // misses allocating an MSHR
+    long long secondary;        // misses merged into an outstanding MSHR
+    long long full;     // misses that found every MSHR busy
+};
+
+// sampled block, for rebuilding the table
+struct sample
+{
+    int time;           // last access time
+    unsigned int block; // block address
+};
+
+// self-profiling data
+struct prof
+{
+    int on;             // the current reference is profiled
+    long long refs;     // references
+    long long samples;  // profiled references
+    long long next;     // next profiled reference
+    unsigned int state; // sampling interval generator state
+    unsigned long long last;    // ticks at the last phase mark
+    unsigned long long cost;    // ticks taken by a phase mark itself
+    unsigned long long ticks[PHASES];   // profiled ticks per phase
+    unsigned long long start;   // ticks at the start of the run
+    unsigned long long stop;    // ticks at the end of the run
+    double wall;        // wall clock time of the run (in ns)
+    int fds[PERFS];     // hardware counter file descriptors, -1=unavailable
+    long long counts[PERFS];    // hardware counter values
 };
 
 /*---------------------------FUNCTION-PROTYTYPES------------------------------*/
 // parser functions
 int get_value(int mode, char *argv);
+int get_hash(char *argv);
+int get_order(char *argv);
+int get_protocol(char *argv);
 
 // initialization functions
 int *init_array(int cols);
@@ -53,19 +320,90 @@ void init_spec(int *values, struct spec *spec);
 void read_spec(struct spec *spec, int argc, char *argv[]);
 void init_data(struct data *data);
 struct line *init_line(int banks, int size);
+struct hash *init_hash(struct spec spec);
+struct mrc *init_mrc(struct spec spec);
+struct prof *init_prof(struct spec spec);
+struct cache *init_cache(struct spec spec);
+struct core *init_cores(struct spec spec, struct cache *llc);
+struct coherence *init_coherence(struct spec spec);
+struct timing *init_timing(struct spec spec);
+void init_sectors(struct spec spec, struct line *line);
+
+// index functions
+void hash_address(struct hash *hash, struct data *data);
+unsigned int h3_hash(unsigned int *table, unsigned int block);
+unsigned int fast_mod(unsigned int value, unsigned long long recip,
+        unsigned int div);
+unsigned int xorshift(unsigned int *state);
+
+// miss ratio curve functions
+void mrc_access(struct mrc *mrc, int address);
+void mrc_rebuild(struct mrc *mrc, int capacity, int size);
+int mrc_find(struct mrc *mrc, unsigned int block);
+int mrc_bin(unsigned long long distance);
+unsigned long long mrc_size(int bin);
+unsigned int mix_hash(unsigned int block);
+int cmp_sample(const void *a, const void *b);
+void free_mrc(struct mrc *mrc);
+
+// self-profiling functions
+void prof_start(struct prof *prof);
+void prof_mark(struct prof *prof, int phase);
+void prof_next(struct prof *prof);
+void prof_stop(struct prof *prof);
+unsigned long long get_ticks(void);
+double get_ns(void);
+
+// multi-core functions
+int cache_access(struct cache *cache, int address, int owner,
+        unsigned int mask);
+void sim_cores(struct spec spec, struct core *cores, struct cache *llc);
+void umon_access(struct core *core, struct cache *llc);
+void ucp_partition(struct core *cores, int n, int banks);
+void *read_trace(void *arg);
+int trace_next(struct trace *trace, struct ref *ref);
+void free_cache(struct cache *cache);
+void free_cores(struct core *cores, int n);
+
+// coherence functions
+void coh_access(struct coherence *coh, int core, int write, int address);
+int snoop(struct coherence *coh, int core, int write, int miss,
+        unsigned int bit, unsigned int *written);
+void fs_record(struct coherence *coh, unsigned int block);
+int fs_find(struct coherence *coh, unsigned int block);
+void free_coherence(struct coherence *coh);
+
+// timing functions
+void tim_access(struct timing *tim, int hit, int address);
+void free_timing(struct timing *tim);
+
+// sector functions
+int sec_search(struct data *data, struct line *line);
+void sec_fill(struct data *data, struct line *line);
+void sec_write(struct data *data, struct line *line);
+int read_rw(void);
 
 // search functions
 int hit_search(struct spec spec, struct data data, struct line *line);
 int rep_search(struct spec spec, struct data data, struct line *line);
 int old_search(struct spec spec, struct data data, struct line *line);
+int inv_search(struct spec spec, struct data data, struct line *line);
 
 // misc math functions
 int pow_2(int power);
 int log_2(int value);
+int prime_floor(int value);
 
 // printer functions
 void print_stats(int hits, int misses);
 void print_spec(struct spec spec);
+void print_hash(struct hash *hash);
+void print_mrc(struct mrc *mrc, int bytes);
+void print_prof(struct prof *prof);
+void print_cores(struct core *cores, int n, struct cache *llc);
+void print_coherence(struct coherence *coh);
+void print_timing(struct timing *tim);
+void print_sectors(struct spec spec, struct data data);
 void print_data(struct data data);
 void print_usage(void);
 void print_error(int mode, char *argv);
@@ -103,6 +441,80 @@ int get_value(int mode, char *argv)
     return size;
 }
 
+/** get_hash()
+ *
+ * Purpose: returns the set index function named by the specified command
+ *          line argument.
+ *
+ * Inputs:  argv - a pointer to the command line argument to parse
+ *
+ * Return:  the set index function mode (HBIT, HXOR, HH3, HMOD, HPRM, HSKW).
+ *
+ */
+int get_hash(char *argv)
+{
+    if (argv == NULL)
+        print_error(3, "");
+    if (strcmp(argv, "bit") == 0)
+        return HBIT;
+    if (strcmp(argv, "xor") == 0)
+        return HXOR;
+    if (strcmp(argv, "h3") == 0)
+        return HH3;
+    if (strcmp(argv, "mod") == 0)
+        return HMOD;
+    if (strcmp(argv, "prime") == 0)
+        return HPRM;
+    if (strcmp(argv, "skew") == 0)
+        return HSKW;
+    print_error(3, argv);
+    return -1;
+}
+
+/** get_order()
+ *
+ * Purpose: returns the core interleaving named by the specified command line
+ *          argument.
+ *
+ * Inputs:  argv - a pointer to the command line argument to parse
+ *
+ * Return:  the core interleaving (ORR, OTS).
+ *
+ */
+int get_order(char *argv)
+{
+    if (argv == NULL)
+        print_error(9, "");
+    if (strcmp(argv, "rr") == 0)
+        return ORR;
+    if (strcmp(argv, "ts") == 0)
+        return OTS;
+    print_error(9, argv);
+    return -1;
+}
+
+/** get_protocol()
+ *
+ * Purpose: returns the coherence protocol named by the specified command
+ *          line argument.
+ *
+ * Inputs:  argv - a pointer to the command line argument to parse
+ *
+ * Return:  the coherence protocol (CMESI, CMOESI).
+ *
+ */
+int get_protocol(char *argv)
+{
+    if (argv == NULL)
+        print_error(11, "");
+    if (strcmp(argv, "mesi") == 0)
+        return CMESI;
+    if (strcmp(argv, "moesi") == 0)
+        return CMOESI;
+    print_error(11, argv);
+    return -1;
+}
+
 /* -- initializer functions ------------------------------------------------- */
 
 /** init_array()
@@ -149,6 +561,26 @@ void init_spec(int *values, struct spec *spec)
     spec->lines = (values[3] > 0) ? values[3] : LINES;
     spec->bytes = (values[4] > 0) ? values[4] : spec->size/(spec->banks*spec->lines);
     spec->offset = (values[5] > 0) ? values[5] : log_2(spec->bytes);
+    spec->hash = HBIT;
+    spec->seed = SEED;
+    spec->rate = 0;
+    spec->max = 0;
+    spec->profile = 0;
+    spec->cores = 0;
+    spec->traces = NULL;
+    spec->masks = NULL;
+    spec->llcsize = LLCSIZE*KB;
+    spec->llcbanks = LLCBANKS;
+    spec->ucp = 0;
+    spec->order = ORR;
+    spec->protocol = 0;
+    spec->cpus = CPUS;
+    spec->mshrs = 0;
+    spec->hitlat = HITLAT;
+    spec->misslat = MISSLAT;
+    spec->bandwidth = 0;
+    spec->issue = 1;
+    spec->sector = 0;
 }
 
 /** read_spec()
@@ -174,6 +606,38 @@ void read_spec(struct spec *spec, int argc, char *argv[])
     spec->caches = 1;
     spec->banks = BANKS;
     spec->bytes = LINES;
+    spec->hash = HBIT;
+    spec->seed = SEED;
+    spec->rate = 0;
+    spec->max = 0;
+    spec->profile = 0;
+    spec->cores = 0;
+    spec->llcsize = LLCSIZE*KB;
+    spec->llcbanks = LLCBANKS;
+    spec->ucp = 0;
+    spec->order = ORR;
+    spec->protocol = 0;
+    spec->cpus = CPUS;
+    spec->mshrs = 0;
+    spec->hitlat = HITLAT;
+    spec->misslat = MISSLAT;
+    spec->bandwidth = 0;
+    spec->issue = 1;
+    spec->sector = 0;
+
+    // allocate the per core traces and way masks
+    spec->traces = malloc(argc*sizeof(char *));
+    spec->masks = malloc(argc*sizeof(unsigned int));
+    if (spec->traces == NULL || spec->masks == NULL)
+    {
+        printf("ERROR! Failed to allocate traces of size %d.\n", argc);
+        exit(-1);
+    }
+    char *timed = NULL;                 // a timing option, if any
+    int masks = 0;
+    for (masks=0; masks<argc; masks++)
+        spec->masks[masks] = 0;
+    masks = 0;
 
     // set the cache specs from command line arguments
     int i=0;
@@ -183,6 +647,16 @@ void read_spec(struct spec *spec, int argc, char *argv[])
         {
             switch (argv[i][1])
             {
+                case '-':
+                {
+                    // long options have no value
+                    if (strcmp(argv[i], "--profile") == 0)
+                        spec->profile = 1;
+                    else
+                        print_error(-1, argv[i]);
+                    i--;
+                    break;
+                }
                 case 's':
                 {
                     spec->size = get_value(0, argv[i+1]);
@@ -198,10 +672,123 @@ void read_spec(struct spec *spec, int argc, char *argv[])
                     spec->bytes = get_value(2, argv[i+1]);
                     break;
                 }
+                case 'i':
+                {
+                    spec->hash = get_hash(argv[i+1]);
+                    break;
+                }
+                case 'k':
+                {
+                    spec->seed = get_value(4, argv[i+1]);
+                    break;
+                }
+                case 'r':
+                {
+                    spec->rate = get_value(5, argv[i+1]);
+                    break;
+                }
+                case 'm':
+                {
+                    spec->max = get_value(6, argv[i+1]);
+                    if (spec->max < MRCS)
+                        print_error(6, argv[i+1]);
+                    if (spec->rate == 0)
+                        spec->rate = 1;
+                    break;
+                }
+                case 't':
+                {
+                    if (argv[i+1] == NULL)
+                        print_error(7, argv[i]);
+                    if (spec->cores == CORES)
+                        print_error(19, argv[i+1]);
+                    spec->traces[spec->cores++] = argv[i+1];
+                    break;
+                }
+                case 'w':
+                {
+                    if (argv[i+1] == NULL)
+                        print_error(8, argv[i]);
+                    spec->masks[masks] = strtoul(argv[i+1], NULL, 16);
+                    if (spec->masks[masks++] == 0)
+                        print_error(8, argv[i+1]);
+                    break;
+                }
+                case 'S':
+                {
+                    spec->llcsize = get_value(0, argv[i+1]);
+                    break;
+                }
+                case 'B':
+                {
+                    spec->llcbanks = get_value(1, argv[i+1]);
+                    break;
+                }
+                case 'u':
+                {
+                    spec->ucp = get_value(10, argv[i+1]);
+                    break;
+                }
+                case 'o':
+                {
+                    spec->order = get_order(argv[i+1]);
+                    break;
+                }
+                case 'c':
+                {
+                    spec->protocol = get_protocol(argv[i+1]);
+                    break;
+                }
+                case 'n':
+                {
+                    spec->cpus = get_value(12, argv[i+1]);
+                    break;
+                }
+                case 'Q':
+                {
+                    spec->mshrs = get_value(13, argv[i+1]);
+                    timed = argv[i];
+                    break;
+                }
+                case 'H':
+                {
+                    spec->hitlat = get_value(14, argv[i+1]);
+                    timed = argv[i];
+                    break;
+                }
+                case 'M':
+                {
+                    spec->misslat = get_value(14, argv[i+1]);
+                    timed = argv[i];
+                    break;
+                }
+                case 'W':
+                {
+                    spec->bandwidth = get_value(15, argv[i+1]);
+                    timed = argv[i];
+                    break;
+                }
+                case 'I':
+                {
+                    spec->issue = get_value(16, argv[i+1]);
+                    timed = argv[i];
+                    break;
+                }
+                case 'e':
+                {
+                    spec->sector = get_value(17, argv[i+1]);
+                    break;
+                }
                 default:
                 {
+                    // the line size has no option flag, i.e.: -16
                     if (i == argc-1)
                         spec->bytes = get_value(2, argv[i]);
+                    else if (argv[i][1] >= '0' && argv[i][1] <= '9')
+                    {
+                        spec->bytes = get_value(2, argv[i]);
+                        i--;
+                    }
                     break;
                 }
             }
@@ -211,6 +798,29 @@ void read_spec(struct spec *spec, int argc, char *argv[])
     // determine lines per bank and address offset
     spec->lines = spec->size/(spec->banks*spec->bytes);
     spec->offset = log_2(spec->lines);
+
+    // sectors divide a line into at most GRANS power of two parts
+    if (spec->sector > 0 && (spec->sector > spec->bytes
+                || spec->bytes/spec->sector > GRANS
+                || pow_2(log_2(spec->sector)) != spec->sector))
+    {
+        char value[16];
+        snprintf(value, sizeof(value), "%d", spec->sector);
+        print_error(17, value);
+    }
+
+    // only the single cache simulation is profiled
+    int modes = (spec->cores > 0 || spec->protocol > 0 || spec->rate > 0);
+    if (modes && spec->profile)
+        print_error(18, "--profile");
+
+    // only the single cache simulation is timed
+    if (modes && timed != NULL)
+        print_error(18, timed);
+
+    // only the single cache simulation is sectored
+    if (modes && spec->sector > 0)
+        print_error(18, "-e");
 }
 
 /** init_data()
@@ -232,6 +842,13 @@ void init_data(struct data *data)
     data->hits = 0;
     data->misses = 0;
     data->bank = 0;
+    data->sets = NULL;
+    data->mask = ~0u;
+    data->owner = 0;
+    data->victim = -1;
+    data->sector = 1;
+    data->sectors = 0;
+    data->writebacks = 0;
 }
 
 /** init_line()
@@ -258,131 +875,1930 @@ struct line *init_line(int banks, int size)
         line[i].lastused = init_array(size);
         line[i].valid = init_array(size);
         line[i].tag = init_array(size);
+        line[i].owner = init_array(size);
+        line[i].state = NULL;
+        line[i].words = NULL;
+        line[i].present = NULL;
+        line[i].dirty = NULL;
     }
     return line;
 }
 
-
-/* -- line search functions ------------------------------------------------- */
-
-/** hit_search()
+/** init_hash()
  *
- * Purpose: searches the cache for a line with a cache hit.
+ * Purpose: returns the set index function data for the specified cache specs,
+ *          precomputing the hash matrix lookup tables and the modulo
+ *          reciprocal so that no division is done per reference.
  *
- * Inputs:  banks - the nubmer of sets in the cache (bank-way set-associative)
- *          index - the index bits from address
- *          tag   - the tag bits from address
- *          valid - the pre-allocated valid bits array for the line
- *          tag   - the pre-allocated tag bits array for the line
- * Return:  the array index for the line with the cache hit.
+ * Inputs:  spec - the cache specs data structure
+ * Return:  a pointer to the allocated set index function data.
  *
- * Requires:    banks > 0; lines > 0; |valid| = banks*lines; |tag| = banks*lines;
- * Ensures:     result : valid[result] = 1 and tag[result] = tag;
+ * Requires:    spec.lines > 0; spec.banks > 0; spec.bytes > 0;
+ * Ensures:     0 < result.sets <= spec.lines;
  *
  */
-int hit_search(struct spec spec, struct data data, struct line *line)
+struct hash *init_hash(struct spec spec)
 {
-    int i=0;
-    for(i=0; i<spec.banks; i++)
-        if(line[i].valid[data.index] && (data.tag == line[i].tag[data.index]))
-            return i;
-    return -1;
+    struct hash *hash = malloc(sizeof(struct hash));
+    if (hash == NULL)
+    {
+        printf("ERROR! Failed to allocate hash of mode %d.\n", spec.hash);
+        exit(-1);
+    }
+    hash->mode = spec.hash;
+    hash->banks = spec.banks;
+    hash->shift = log_2(spec.bytes);
+    hash->sshift = (spec.sector > 0) ? log_2(spec.sector) : hash->shift;
+    hash->bits = log_2(spec.lines);
+    hash->sets = pow_2(hash->bits);
+    hash->reduce = 0;
+    hash->h3 = NULL;
+
+    // modulo functions use every line, or the largest prime number of them
+    if (hash->mode == HMOD || hash->mode == HPRM)
+        hash->sets = (hash->mode == HPRM) ? prime_floor(spec.lines) : spec.lines;
+
+    // other functions hash to 9 more bits than a non power of two number of
+    // sets needs, then reduce the hash modulo the sets, i.e.: sliced caches
+    else if (hash->sets < (unsigned int) spec.lines)
+    {
+        hash->reduce = 1;
+        hash->sets = spec.lines;
+        hash->bits = (hash->bits + 9 < ABITS) ? hash->bits + 9 : ABITS-1;
+    }
+    hash->recip = 0xFFFFFFFFFFFFFFFFULL/hash->sets + 1;
+    hash->mask = (1u << hash->bits) - 1;
+
+    // fill one H3 matrix, or one per bank if skewed, as byte lookup tables
+    if (hash->mode == HH3 || hash->mode == HSKW)
+    {
+        int tables = (hash->mode == HSKW) ? spec.banks : 1;
+        hash->h3 = malloc(tables*4*256*sizeof(unsigned int));
+        if (hash->h3 == NULL)
+        {
+            printf("ERROR! Failed to allocate hash matrix of size %d.\n",
+                    tables);
+            exit(-1);
+        }
+        unsigned int state = spec.seed;
+        int t, i, j, v;
+        for (t=0; t<tables; t++)
+        {
+            unsigned int *table = &hash->h3[t*4*256];
+            for (i=0; i<4; i++)
+            {
+                // random matrix rows for the 8 address bits of this byte
+                unsigned int row[8];
+                for (j=0; j<8; j++)
+                    row[j] = xorshift(&state) & hash->mask;
+
+                // each table entry is the xor of the rows of its set bits
+                for (v=0; v<256; v++)
+                {
+                    table[i*256 + v] = 0;
+                    for (j=0; j<8; j++)
+                        if (v & (1 << j))
+                            table[i*256 + v] ^= row[j];
+                }
+            }
+        }
+    }
+    return hash;
 }
 
-/** rep_search()
+/** init_mrc()
  *
- * Purpose: searches the cache for the replacement line.
+ * Purpose: returns the sampled reuse distance data for the specified cache
+ *          specs, sampling 1/rate of the blocks and at most max of them.
  *
- * Inputs:  banks - the nubmer of sets in the cache (bank-way set-associative)
- *          index - the index bits from address
- *          valid - the pre-allocated valid bits array for the line
- * Return:  the array index for the replacement line.
+ * Inputs:  spec - the cache specs data structure
+ * Return:  a pointer to the allocated reuse distance data.
  *
- * Requires:    banks > 0; lines > 0; |valid| = banks*lines;
- * Ensures:     result : valid[result] = 0 and valid[i] = 1, for all i < result;
+ * Requires:    spec.rate > 0; spec.bytes > 0;
+ * Ensures:     result.count = 0; result.hist[i] = 0, for all i;
  *
  */
-int rep_search(struct spec spec, struct data data, struct line *line)
+struct mrc *init_mrc(struct spec spec)
 {
-    int i=0;
-    for(i=0; i<spec.banks; i++)
-        if(!line[i].valid[data.index])
-            return i;
-    return -1;
+    struct mrc *mrc = malloc(sizeof(struct mrc));
+    if (mrc == NULL)
+    {
+        printf("ERROR! Failed to allocate mrc of rate %d.\n", spec.rate);
+        exit(-1);
+    }
+    mrc->shift = log_2(spec.bytes);
+    mrc->max = spec.max;
+    mrc->threshold = (spec.rate < MRCP) ? MRCP/spec.rate : 1;
+    mrc->count = 0;
+    mrc->capacity = 0;
+    mrc->bits = 0;
+    mrc->block = NULL;
+    mrc->time = NULL;
+    mrc->size = 0;
+    mrc->tree = NULL;
+    mrc->clock = 0;
+    mrc->refs = 0;
+    mrc->cold = 0.0;
+    int i;
+    for (i=0; i<MRCB; i++)
+        mrc->hist[i] = 0.0;
+
+    // size the table for the max sampled blocks, or grow it as needed
+    int blocks = (spec.max > 0) ? spec.max : MRCT;
+    int capacity = MRCT;
+    while (capacity < 2*blocks)
+        capacity *= 2;
+    mrc_rebuild(mrc, capacity, 2*blocks);
+    return mrc;
 }
 
-/** old_search()
+/** init_prof()
  *
- * Purpose: searches the cache for the oldest line in the set.
+ * Purpose: returns the self-profiling data for the specified cache specs,
+ *          opening the host hardware counters where permitted.
  *
- * Inputs:  banks - the nubmer of sets in the cache (bank-way set-associative)
- *          index - the index bits from address
- *          lastused - the pre-allocated access count array for the line
- * Return:  the array index for the oldest line in the set.
+ * Inputs:  spec - the cache specs data structure
+ * Return:  a pointer to the allocated self-profiling data.
  *
- * Requires:    banks > 0; lines > 0; |lastused| = banks*lines;
- * Ensures:     result : lastused[result] < lastused[i], for all i != result;
+ * Ensures:     result.on = 0; result.fds[i] = -1 if counter i is unavailable
+ *              or spec.profile = 0;
  *
  */
-int old_search(struct spec spec, struct data data, struct line *line)
+struct prof *init_prof(struct spec spec)
 {
-    int bank = 0;
-    int i=0;
-    for(i=1; i<spec.banks; i++)
-        if(line[i].lastused[data.index] < line[bank].lastused[data.index])
-            bank = i;
-    return bank;
-}
-
+    struct prof *prof = malloc(sizeof(struct prof));
+    if (prof == NULL)
+    {
+        printf("ERROR! Failed to allocate prof of mode %d.\n", spec.profile);
+        exit(-1);
+    }
+    memset(prof, 0, sizeof(struct prof));
+    int i;
+    for (i=0; i<PERFS; i++)
+        prof->fds[i] = -1;
+    if (!spec.profile)
+        return prof;
 
-/* -- miscellaneous math -- */
+#ifdef __linux__
+    // cycles, instructions, LLC misses, and branch misses of this process
+    unsigned long long configs[PERFS] = {PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES};
+    for (i=0; i<PERFS; i++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        prof->fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+    return prof;
+}
 
-/** pow_2()
+/** init_cache()
  *
- * Purpose: returns the value of 2 raised to the specified power.
+ * Purpose: returns a simulated cache with the specified cache specs, with
+ *          all lines invalid.
  *
- * Inputs:  power - the power exponent to raise 2 to
- * Return:  the value of 2 raised to the power
+ * Inputs:  spec - the cache specs data structure
+ * Return:  a pointer to the allocated cache.
  *
- * Requires:    power >= 0;
- * Ensures:     result = 2^power;
+ * Requires:    spec.banks > 0; spec.lines > 0;
  *
  */
-int pow_2(int power)
+struct cache *init_cache(struct spec spec)
 {
-    if (power < 0)
-        return -1;
-    int result = 1;
-    int i=0;
-    for (i=0; i<power; i++)
-        result *= 2;
-    return result;
+    struct cache *cache = malloc(sizeof(struct cache));
+    if (cache == NULL)
+    {
+        printf("ERROR! Failed to allocate cache of size %d.\n", spec.size);
+        exit(-1);
+    }
+    cache->spec = spec;
+    cache->hash = init_hash(spec);
+    cache->line = init_line(spec.banks, spec.lines);
+    init_data(&cache->data);
+    if (spec.hash == HSKW)
+        cache->data.sets = init_array(spec.banks);
+    return cache;
 }
 
-/** log_2()
+/** init_cores()
  *
- * Purpose: returns the log base 2 of the specified value.
+ * Purpose: returns the simulated cores, one per trace file, each with a
+ *          private cache and a trace reader thread, and with the shared
+ *          cache way masks from the specs or split evenly if utility-based.
  *
- * Inputs:  value - the value to take the log base 2 of
- * Return:  the log base 2 of the value
+ * Inputs:  spec - the cache specs data structure, of the private caches
+ *          llc  - the shared cache
+ * Return:  a pointer to the allocated array of spec.cores cores.
  *
- * Requires:    value > 0; value mod 2 = 0 or value = 1;
- * Ensures:     result = log_2(value);
+ * Requires:    spec.cores > 0; |spec.traces| = spec.cores;
+ * Ensures:     result[i].ref is the first reference of trace i, if live;
  *
  */
-int log_2(int value)
+struct core *init_cores(struct spec spec, struct cache *llc)
 {
-    if (value < 1)
-        return -1;
-    int result = value/2;
-    int i=0;
-    while (result > 0)
+    struct core *cores = malloc(spec.cores*sizeof(struct core));
+    if (cores == NULL)
     {
-        result /= 2;
-        i++;
+        printf("ERROR! Failed to allocate cores of size %d.\n", spec.cores);
+        exit(-1);
     }
-    return i;
-}
+    int banks = (llc->spec.banks < 32) ? llc->spec.banks : 32;
+    unsigned int all = (banks < 32) ? (1u << banks) - 1 : ~0u;
+    int sampled = (llc->hash->sets + UMONS - 1)/UMONS;
+    int masked = spec.ucp;
+    int c;
+    for (c=0; c<spec.cores; c++)
+        masked |= (spec.masks[c] != 0);
+    if (masked && llc->spec.banks > 32)
+    {
+        printf("ERROR! Failed to partition %d banks, masks cover 32 banks.\n",
+                llc->spec.banks);
+        exit(-1);
+    }
+    if (spec.ucp && spec.cores > banks)
+    {
+        printf("ERROR! Failed to partition %d banks for %d cores.\n", banks,
+                spec.cores);
+        exit(-1);
+    }
+
+    for (c=0; c<spec.cores; c++)
+    {
+        struct core *core = &cores[c];
+        core->name = spec.traces[c];
+        core->l1 = init_cache(spec);
+        core->hits = 0;
+        core->misses = 0;
+        core->evicted = 0;
+        core->evictor = 0;
+
+        // static way masks, or an even split to start utility-based
+        core->mask = (spec.masks[c] != 0) ? spec.masks[c] & all : all;
+        if (spec.ucp)
+            core->mask = all & ~((1u << c*banks/spec.cores) - 1)
+                & ((c+1 == spec.cores) ? all : (1u << (c+1)*banks/spec.cores) - 1);
+        if (core->mask == 0)
+        {
+            char value[16];
+            snprintf(value, sizeof(value), "%x", spec.masks[c]);
+            print_error(8, value);
+        }
+
+        // UMON hit counters and tag stacks of the sampled sets
+        core->umon = NULL;
+        core->atd = NULL;
+        core->depth = NULL;
+        if (spec.ucp)
+        {
+            core->umon = calloc(llc->spec.banks, sizeof(long long));
+            core->atd = init_array(sampled*llc->spec.banks);
+            core->depth = init_array(sampled);
+            if (core->umon == NULL)
+            {
+                printf("ERROR! Failed to allocate umon of size %d.\n",
+                        llc->spec.banks);
+                exit(-1);
+            }
+        }
+
+        // start the trace reader
+        struct trace *trace = &core->trace;
+        trace->file = fopen(core->name, "r");
+        if (trace->file == NULL)
+            print_error(7, core->name);
+        trace->order = spec.order;
+        trace->chunks = malloc(QDEPTH*sizeof(struct chunk));
+        if (trace->chunks == NULL)
+        {
+            printf("ERROR! Failed to allocate chunks of size %d.\n", QDEPTH);
+            exit(-1);
+        }
+        trace->head = 0;
+        trace->count = 0;
+        trace->cur = NULL;
+        trace->pos = 0;
+        pthread_mutex_init(&trace->lock, NULL);
+        pthread_cond_init(&trace->cond, NULL);
+        if (pthread_create(&trace->thread, NULL, read_trace, trace) != 0)
+        {
+            printf("ERROR! Failed to start reader of core %d.\n", c);
+            exit(-1);
+        }
+    }
+
+    // the first reference of each core, once all readers are running
+    for (c=0; c<spec.cores; c++)
+        cores[c].live = trace_next(&cores[c].trace, &cores[c].ref);
+    return cores;
+}
+
+/** init_coherence()
+ *
+ * Purpose: returns the coherent private caches, one per core, with the
+ *          specified cache specs, all lines invalid.
+ *
+ * Inputs:  spec - the cache specs data structure
+ * Return:  a pointer to the allocated coherent caches.
+ *
+ * Requires:    spec.protocol > 0; spec.cpus > 0;
+ * Ensures:     result.caches[i].line[j].state[k] = CI, for all i, j, k;
+ *
+ */
+struct coherence *init_coherence(struct spec spec)
+{
+    struct coherence *coh = calloc(1, sizeof(struct coherence));
+    if (coh != NULL)
+        coh->caches = malloc(spec.cpus*sizeof(struct cache *));
+    if (coh == NULL || coh->caches == NULL)
+    {
+        printf("ERROR! Failed to allocate coherence of size %d.\n", spec.cpus);
+        exit(-1);
+    }
+    coh->protocol = spec.protocol;
+    coh->n = spec.cpus;
+
+    // track the written granules of up to GRANS per line, of at least 4 bytes
+    coh->gshift = log_2((spec.bytes/GRANS > 4) ? spec.bytes/GRANS : 4);
+
+    int c, i;
+    for (c=0; c<coh->n; c++)
+    {
+        struct cache *cache = init_cache(spec);
+        for (i=0; i<spec.banks; i++)
+        {
+            cache->line[i].state = calloc(spec.lines, sizeof(unsigned char));
+            cache->line[i].words = calloc(spec.lines, sizeof(unsigned int));
+            if (cache->line[i].state == NULL || cache->line[i].words == NULL)
+            {
+                printf("ERROR! Failed to allocate state of size %d.\n",
+                        spec.lines);
+                exit(-1);
+            }
+        }
+        coh->caches[c] = cache;
+    }
+
+    coh->capacity = FSTABLE;
+    coh->count = 0;
+    coh->fsblock = calloc(FSTABLE, sizeof(unsigned int));
+    coh->fscount = calloc(FSTABLE, sizeof(long long));
+    if (coh->fsblock == NULL || coh->fscount == NULL)
+    {
+        printf("ERROR! Failed to allocate table of size %d.\n", FSTABLE);
+        exit(-1);
+    }
+    return coh;
+}
+
+/** init_timing()
+ *
+ * Purpose: returns the non-blocking cache timing data for the specified
+ *          cache specs, with every MSHR free.
+ *
+ * Inputs:  spec - the cache specs data structure
+ * Return:  a pointer to the allocated timing data.
+ *
+ * Requires:    spec.mshrs > 0;
+ *
+ */
+struct timing *init_timing(struct spec spec)
+{
+    struct timing *tim = calloc(1, sizeof(struct timing));
+    if (tim != NULL)
+    {
+        tim->block = calloc(spec.mshrs, sizeof(unsigned int));
+        tim->ready = calloc(spec.mshrs, sizeof(long long));
+    }
+    if (tim == NULL || tim->block == NULL || tim->ready == NULL)
+    {
+        printf("ERROR! Failed to allocate timing of size %d.\n", spec.mshrs);
+        exit(-1);
+    }
+    tim->mshrs = spec.mshrs;
+    tim->hitlat = spec.hitlat;
+    tim->misslat = spec.misslat;
+    // a miss fills one sector of a sectored line
+    int fill = (spec.sector > 0) ? spec.sector : spec.bytes;
+    tim->xfer = (spec.bandwidth > 0) ?
+        (fill + spec.bandwidth - 1)/spec.bandwidth : 0;
+    tim->issue = spec.issue;
+    tim->shift = log_2(fill);
+    return tim;
+}
+
+/** init_sectors()
+ *
+ * Purpose: allocates the valid and dirty sector masks of the cache lines,
+ *          with every sector invalid.
+ *
+ * Inputs:  spec - the cache specs data structure
+ *          line - the cache line arrays
+ *
+ * Requires:    spec.sector > 0; |line| = spec.banks;
+ * Ensures:     line[i].present[j] = line[i].dirty[j] = 0, for all i, j;
+ *
+ */
+void init_sectors(struct spec spec, struct line *line)
+{
+    int i;
+    for (i=0; i<spec.banks; i++)
+    {
+        line[i].present = calloc(spec.lines, sizeof(unsigned int));
+        line[i].dirty = calloc(spec.lines, sizeof(unsigned int));
+        if (line[i].present == NULL || line[i].dirty == NULL)
+        {
+            printf("ERROR! Failed to allocate sectors of size %d.\n",
+                    spec.lines);
+            exit(-1);
+        }
+    }
+}
+
+
+/* -- index functions ------------------------------------------------------- */
+
+/** hash_address()
+ *
+ * Purpose: sets the index and tag bits of the current address using the
+ *          set index function, the index bits per bank if skewed, and the
+ *          sector bit of the address in its line.
+ *
+ * Inputs:  hash - the set index function data
+ *          data - a pointer to the cache simulation data
+ *
+ * Requires:    hash != null; data != null; |data.sets| = hash.banks if skewed;
+ * Ensures:     0 <= data.index < hash.sets; data.tag identifies the block
+ *              within its set;
+ *
+ */
+void hash_address(struct hash *hash, struct data *data)
+{
+    unsigned int block = ((unsigned int) data->address) >> hash->shift;
+    unsigned int offset = ((unsigned int) data->address) & ((1u << hash->shift) - 1);
+    data->sector = 1u << (offset >> hash->sshift);
+    unsigned int fold = 0;
+    int i;
+    switch (hash->mode)
+    {
+        case HBIT:
+        {
+            if (hash->reduce)
+            {
+                data->index = fast_mod(block, hash->recip, hash->sets);
+                data->tag = block;
+                return;
+            }
+            data->index = block & hash->mask;
+            data->tag = (hash->bits < ABITS) ? block >> hash->bits : 0;
+            return;
+        }
+        case HXOR:
+        {
+            // fold the whole block address onto the index bits
+            data->index = 0;
+            for (fold=block; hash->bits > 0 && fold; fold >>= hash->bits)
+                data->index ^= fold & hash->mask;
+            if (hash->reduce)
+            {
+                data->index = fast_mod(data->index, hash->recip, hash->sets);
+                data->tag = block;
+                return;
+            }
+            data->tag = (hash->bits < ABITS) ? block >> hash->bits : 0;
+            return;
+        }
+        case HH3:
+        {
+            data->index = h3_hash(hash->h3, block);
+            if (hash->reduce)
+                data->index = fast_mod(data->index, hash->recip, hash->sets);
+            data->tag = block;
+            return;
+        }
+        case HMOD:
+        case HPRM:
+        {
+            data->index = fast_mod(block, hash->recip, hash->sets);
+            data->tag = block;
+            return;
+        }
+        case HSKW:
+        {
+            for (i=0; i<hash->banks; i++)
+            {
+                data->sets[i] = h3_hash(&hash->h3[i*4*256], block);
+                if (hash->reduce)
+                    data->sets[i] = fast_mod(data->sets[i], hash->recip,
+                            hash->sets);
+            }
+            data->index = data->sets[0];
+            data->tag = block;
+            return;
+        }
+    }
+}
+
+/** h3_hash()
+ *
+ * Purpose: returns the H3 hash of the block address, one table lookup per
+ *          address byte.
+ *
+ * Inputs:  table - the 4*256 byte lookup tables of the hash matrix
+ *          block - the block address
+ * Return:  the xor of the matrix rows selected by the block address bits.
+ *
+ */
+unsigned int h3_hash(unsigned int *table, unsigned int block)
+{
+    return table[block & 0xff]
+         ^ table[256 + ((block >> 8) & 0xff)]
+         ^ table[512 + ((block >> 16) & 0xff)]
+         ^ table[768 + (block >> 24)];
+}
+
+/** fast_mod()
+ *
+ * Purpose: returns value mod div using a precomputed multiply-shift
+ *          reciprocal instead of a division.
+ *
+ * Inputs:  value - the dividend
+ *          recip - the reciprocal, 2^64/div + 1 (mod 2^64)
+ *          div   - the divisor
+ * Return:  value mod div
+ *
+ * Requires:    div > 0;
+ * Ensures:     result = value mod div;
+ *
+ */
+unsigned int fast_mod(unsigned int value, unsigned long long recip,
+        unsigned int div)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned long long low = recip*value;
+    return (unsigned int) (((unsigned __int128) low*div) >> 64);
+#else
+    return value % div;
+#endif
+}
+
+/** xorshift()
+ *
+ * Purpose: returns the next value of a xorshift pseudo-random sequence.
+ *
+ * Inputs:  state - a pointer to the nonzero generator state
+ * Return:  the next pseudo-random value.
+ *
+ */
+unsigned int xorshift(unsigned int *state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+
+/* -- line search functions ------------------------------------------------- */
+
+/** hit_search()
+ *
+ * Purpose: searches the cache for a line with a cache hit.
+ *
+ * Inputs:  banks - the nubmer of sets in the cache (bank-way set-associative)
+ *          index - the index bits from address
+ *          tag   - the tag bits from address
+ *          valid - the pre-allocated valid bits array for the line
+ *          tag   - the pre-allocated tag bits array for the line
+ * Return:  the array index for the line with the cache hit.
+ *
+ * Requires:    banks > 0; lines > 0; |valid| = banks*lines; |tag| = banks*lines;
+ * Ensures:     result : valid[result] = 1 and tag[result] = tag;
+ *
+ */
+int hit_search(struct spec spec, struct data data, struct line *line)
+{
+    int i=0;
+    for(i=0; i<spec.banks; i++)
+        if(line[i].valid[SET(data, i)] && (data.tag == line[i].tag[SET(data, i)]))
+            return i;
+    return -1;
+}
+
+/** rep_search()
+ *
+ * Purpose: searches the cache for the replacement line, in the banks of
+ *          the data mask.
+ *
+ * Inputs:  banks - the nubmer of sets in the cache (bank-way set-associative)
+ *          index - the index bits from address
+ *          valid - the pre-allocated valid bits array for the line
+ * Return:  the array index for the replacement line.
+ *
+ * Requires:    banks > 0; lines > 0; |valid| = banks*lines;
+ * Ensures:     result : valid[result] = 0 and valid[i] = 1, for all i < result;
+ *
+ */
+int rep_search(struct spec spec, struct data data, struct line *line)
+{
+    int i=0;
+    for(i=0; i<spec.banks; i++)
+        if(!line[i].valid[SET(data, i)] && WAY(data, i))
+            return i;
+    return -1;
+}
+
+/** old_search()
+ *
+ * Purpose: searches the cache for the oldest line in the set, in the banks
+ *          of the data mask.
+ *
+ * Inputs:  banks - the nubmer of sets in the cache (bank-way set-associative)
+ *          index - the index bits from address
+ *          lastused - the pre-allocated access count array for the line
+ * Return:  the array index for the oldest line in the set.
+ *
+ * Requires:    banks > 0; lines > 0; |lastused| = banks*lines;
+ * Ensures:     result : lastused[result] < lastused[i], for all i != result;
+ *
+ */
+int old_search(struct spec spec, struct data data, struct line *line)
+{
+    int bank = -1;
+    int i=0;
+    for(i=0; i<spec.banks; i++)
+        if(WAY(data, i) && (bank == -1
+                    || line[i].lastused[SET(data, i)] < line[bank].lastused[SET(data, bank)]))
+            bank = i;
+    return bank;
+}
+
+/** inv_search()
+ *
+ * Purpose: searches the cache for an invalidated line with a matching tag.
+ *
+ * Inputs:  spec - the cache specs
+ *          data - the cache simulation data of the reference
+ *          line - the cache line arrays, with coherence states
+ * Return:  the array index for the invalidated line, or -1.
+ *
+ * Requires:    |line[i].state| = |line[i].words| = lines, for all i;
+ * Ensures:     result : state[result] = CI and words[result] != 0 and
+ *              tag[result] = tag;
+ *
+ */
+int inv_search(struct spec spec, struct data data, struct line *line)
+{
+    int i=0;
+    for(i=0; i<spec.banks; i++)
+        if(!line[i].valid[SET(data, i)] && line[i].words[SET(data, i)]
+                && (data.tag == line[i].tag[SET(data, i)]))
+            return i;
+    return -1;
+}
+
+
+/* -- miss ratio curve functions -------------------------------------------- */
+
+/** mrc_access()
+ *
+ * Purpose: simulates a reference on a fully-associative LRU stack of the
+ *          sampled blocks, adding the scaled reuse distance of the reference
+ *          to the reuse distance histogram (SHARDS).
+ *
+ * Inputs:  mrc     - the sampled reuse distance data
+ *          address - the 32-bit address of the reference
+ *
+ * Requires:    mrc != null;
+ * Ensures:     mrc.count <= mrc.max, if mrc.max > 0;
+ *
+ */
+void mrc_access(struct mrc *mrc, int address)
+{
+    unsigned int block = ((unsigned int) address) >> mrc->shift;
+    mrc->refs++;
+    if ((mix_hash(block) >> 8) >= mrc->threshold)
+        return;
+
+    // each sampled reference stands for MRCP/threshold references
+    double scale = (double) MRCP/mrc->threshold;
+    int slot = mrc_find(mrc, block);
+    int t, i;
+    if (mrc->time[slot] >= 0)
+    {
+        // count the sampled blocks used since the last access to this one
+        int older = 0;
+        for (i=mrc->time[slot]+1; i>0; i -= i & -i)
+            older += mrc->tree[i];
+        unsigned long long distance = (mrc->count - older)*scale;
+        mrc->hist[mrc_bin(distance)] += scale;
+        for (i=mrc->time[slot]+1; i<=mrc->size; i += i & -i)
+            mrc->tree[i]--;
+    }
+    else
+    {
+        mrc->cold += scale;
+        mrc->block[slot] = block;
+        mrc->count++;
+    }
+
+    // renumber the last access times once the tree is full
+    t = mrc->clock++;
+    mrc->time[slot] = t;
+    for (i=t+1; i<=mrc->size; i += i & -i)
+        mrc->tree[i]++;
+    if (mrc->clock == mrc->size || 2*mrc->count > mrc->capacity)
+    {
+        int capacity = mrc->capacity;
+        int size = mrc->size;
+        while (2*mrc->count > capacity)
+            capacity *= 2;
+        while (2*mrc->count > size)
+            size *= 2;
+        mrc_rebuild(mrc, capacity, size);
+    }
+
+    // lower the sampling rate until the max sampled blocks fit
+    while (mrc->max > 0 && mrc->count > mrc->max && mrc->threshold > 1)
+    {
+        mrc->threshold -= (mrc->threshold/8 > 0) ? mrc->threshold/8 : 1;
+        mrc_rebuild(mrc, mrc->capacity, mrc->size);
+    }
+}
+
+/** mrc_rebuild()
+ *
+ * Purpose: rebuilds the sampled block table and the last access time tree,
+ *          dropping the blocks above the sampling threshold and renumbering
+ *          the last access times of the others from zero.
+ *
+ * Inputs:  mrc      - the sampled reuse distance data
+ *          capacity - the new table size, a power of two
+ *          size     - the new last access time tree size
+ *
+ * Requires:    mrc != null; capacity >= 2*mrc.count; size >= 2*mrc.count;
+ * Ensures:     mrc.clock = mrc.count; the LRU order of the blocks is kept;
+ *
+ */
+void mrc_rebuild(struct mrc *mrc, int capacity, int size)
+{
+    // collect the sampled blocks in LRU order
+    struct sample *samples = malloc((mrc->count + 1)*sizeof(struct sample));
+    if (samples == NULL)
+    {
+        printf("ERROR! Failed to allocate samples of size %d.\n", mrc->count);
+        exit(-1);
+    }
+    int n = 0;
+    int i, j;
+    for (i=0; i<mrc->capacity; i++)
+    {
+        if (mrc->time[i] >= 0 && (mix_hash(mrc->block[i]) >> 8) < mrc->threshold)
+        {
+            samples[n].time = mrc->time[i];
+            samples[n].block = mrc->block[i];
+            n++;
+        }
+    }
+    qsort(samples, n, sizeof(struct sample), cmp_sample);
+
+    // reallocate the table and tree
+    free(mrc->block);
+    free(mrc->time);
+    free(mrc->tree);
+    mrc->capacity = capacity;
+    mrc->bits = log_2(capacity);
+    mrc->size = size;
+    mrc->block = malloc(capacity*sizeof(unsigned int));
+    mrc->time = malloc(capacity*sizeof(int));
+    mrc->tree = init_array(size+1);
+    if (mrc->block == NULL || mrc->time == NULL)
+    {
+        printf("ERROR! Failed to allocate table of size %d.\n", capacity);
+        exit(-1);
+    }
+    for (i=0; i<capacity; i++)
+        mrc->time[i] = -1;
+
+    // reinsert the blocks with their renumbered last access times
+    mrc->count = 0;
+    for (i=0; i<n; i++)
+    {
+        int slot = mrc_find(mrc, samples[i].block);
+        mrc->block[slot] = samples[i].block;
+        mrc->time[slot] = i;
+        mrc->tree[i+1] = 1;
+        mrc->count++;
+    }
+    for (i=1; i<=size; i++)
+    {
+        j = i + (i & -i);
+        if (j <= size)
+            mrc->tree[j] += mrc->tree[i];
+    }
+    mrc->clock = n;
+    free(samples);
+}
+
+/** mrc_find()
+ *
+ * Purpose: returns the table slot of the specified block, or the empty slot
+ *          to insert it in.
+ *
+ * Inputs:  mrc   - the sampled reuse distance data
+ *          block - the block address
+ * Return:  the table slot of the block, or an empty slot.
+ *
+ * Requires:    mrc.count < mrc.capacity;
+ * Ensures:     mrc.block[result] = block or mrc.time[result] = -1;
+ *
+ */
+int mrc_find(struct mrc *mrc, unsigned int block)
+{
+    int slot = (block*0x9E3779B1u) >> (ABITS - mrc->bits);
+    while (mrc->time[slot] >= 0 && mrc->block[slot] != block)
+        slot = (slot + 1) & (mrc->capacity - 1);
+    return slot;
+}
+
+/** mrc_bin()
+ *
+ * Purpose: returns the histogram bin of a reuse distance, exact below 8 and
+ *          four bins per power of two above.
+ *
+ * Inputs:  distance - the reuse distance (in blocks)
+ * Return:  the bin : mrc_size(result) <= distance < mrc_size(result+1).
+ *
+ */
+int mrc_bin(unsigned long long distance)
+{
+    if (distance < 8)
+        return (int) distance;
+    int e = 3;
+    while (e < 63 && (distance >> (e+1)) > 0)
+        e++;
+    int bin = 8 + (e-3)*4 + (int) ((distance >> (e-2)) & 3);
+    return (bin < MRCB) ? bin : MRCB-1;
+}
+
+/** mrc_size()
+ *
+ * Purpose: returns the smallest reuse distance of a histogram bin, which is
+ *          the smallest cache size (in blocks) that hits all of the bins
+ *          below it.
+ *
+ * Inputs:  bin - the histogram bin
+ * Return:  the lower bound of the bin.
+ *
+ */
+unsigned long long mrc_size(int bin)
+{
+    if (bin < 8)
+        return bin;
+    int e = 3 + (bin-8)/4;
+    return (unsigned long long) (4 + (bin-8)%4) << (e-2);
+}
+
+/** mix_hash()
+ *
+ * Purpose: returns a well mixed 32-bit hash of the block address (the
+ *          murmur3 finalizer).
+ *
+ * Inputs:  block - the block address
+ * Return:  the hash of the block address.
+ *
+ */
+unsigned int mix_hash(unsigned int block)
+{
+    block ^= block >> 16;
+    block *= 0x85ebca6bu;
+    block ^= block >> 13;
+    block *= 0xc2b2ae35u;
+    block ^= block >> 16;
+    return block;
+}
+
+/** cmp_sample()
+ *
+ * Purpose: compares two sampled blocks by last access time, for qsort.
+ *
+ */
+int cmp_sample(const void *a, const void *b)
+{
+    return ((const struct sample *) a)->time - ((const struct sample *) b)->time;
+}
+
+/** free_mrc()
+ *
+ * Purpose: frees the sampled reuse distance data.
+ *
+ */
+void free_mrc(struct mrc *mrc)
+{
+    free(mrc->block);
+    free(mrc->time);
+    free(mrc->tree);
+    free(mrc);
+}
+
+
+/* -- self-profiling functions ---------------------------------------------- */
+
+/** prof_start()
+ *
+ * Purpose: starts the profiled run, enabling the hardware counters and
+ *          profiling the first reference.
+ *
+ * Inputs:  prof - the self-profiling data
+ *
+ */
+void prof_start(struct prof *prof)
+{
+    int i;
+    for (i=0; i<PERFS; i++)
+    {
+#ifdef __linux__
+        if (prof->fds[i] >= 0)
+        {
+            ioctl(prof->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(prof->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    // the cheapest back to back reads are the cost of a phase mark
+    unsigned long long t;
+    prof->cost = ~0ULL;
+    for (i=0; i<PSAMP; i++)
+    {
+        t = get_ticks();
+        t = get_ticks() - t;
+        prof->cost = (t < prof->cost) ? t : prof->cost;
+    }
+
+    prof->wall = get_ns();
+    prof->start = get_ticks();
+    prof->last = prof->start;
+    prof->state = SEED;
+    prof->next = PSAMP/2 + xorshift(&prof->state) % PSAMP;
+    prof->on = 1;
+}
+
+/** prof_mark()
+ *
+ * Purpose: ends the specified phase of a profiled reference, adding the
+ *          ticks since the last phase mark to the phase.
+ *
+ * Inputs:  prof  - the self-profiling data
+ *          phase - the ending phase (PPARSE, PINDEX, ...)
+ *
+ */
+void prof_mark(struct prof *prof, int phase)
+{
+    if (!prof->on)
+        return;
+    unsigned long long now = get_ticks();
+    if (now - prof->last > prof->cost)
+        prof->ticks[phase] += now - prof->last - prof->cost;
+    prof->last = now;
+}
+
+/** prof_next()
+ *
+ * Purpose: ends a reference, profiling the next one if it is sampled at a
+ *          random interval of PSAMP references on average.
+ *
+ * Inputs:  prof - the self-profiling data
+ *
+ */
+void prof_next(struct prof *prof)
+{
+    prof->samples += prof->on;
+    prof->refs++;
+    prof->on = prof->start && prof->refs == prof->next;
+    if (prof->on)
+    {
+        // jitter the interval so it does not alias with periodic work,
+        // i.e.: output buffer flushes
+        prof->next += PSAMP/2 + xorshift(&prof->state) % PSAMP;
+        prof->last = get_ticks();
+    }
+}
+
+/** prof_stop()
+ *
+ * Purpose: stops the profiled run, reading the hardware counters.
+ *
+ * Inputs:  prof - the self-profiling data
+ *
+ */
+void prof_stop(struct prof *prof)
+{
+    prof->stop = get_ticks();
+    prof->wall = get_ns() - prof->wall;
+    prof->on = 0;
+    int i;
+    for (i=0; i<PERFS; i++)
+    {
+#ifdef __linux__
+        if (prof->fds[i] >= 0)
+        {
+            ioctl(prof->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(prof->fds[i], &prof->counts[i], sizeof(long long))
+                    != sizeof(long long))
+                prof->counts[i] = -1;
+            close(prof->fds[i]);
+        }
+#endif
+    }
+}
+
+/** get_ticks()
+ *
+ * Purpose: returns the time stamp counter, or the monotonic clock (in ns)
+ *          where there is none.
+ *
+ */
+unsigned long long get_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (unsigned long long) get_ns();
+#endif
+}
+
+/** get_ns()
+ *
+ * Purpose: returns the monotonic clock (in ns).
+ *
+ */
+double get_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+
+/* -- multi-core functions -------------------------------------------------- */
+
+/** cache_access()
+ *
+ * Purpose: simulates a reference on a cache, replacing the oldest line
+ *          of the banks in the mask on a miss.
+ *
+ * Inputs:  cache   - the simulated cache
+ *          address - the 32-bit address of the reference
+ *          owner   - the core of the reference
+ *          mask    - the banks the replacement may use
+ * Return:  1 for a cache hit, 0 for a cache miss.
+ *
+ * Requires:    cache != null; mask selects at least one bank;
+ * Ensures:     cache.data.victim = the core of the replaced line, or -1;
+ *
+ */
+int cache_access(struct cache *cache, int address, int owner,
+        unsigned int mask)
+{
+    struct data *data = &cache->data;
+    struct line *line = cache->line;
+    data->address = address;
+    data->access++;
+    data->owner = owner;
+    data->mask = mask;
+    data->victim = -1;
+    hash_address(cache->hash, data);
+
+    // search for hit
+    data->bank = hit_search(cache->spec, *data, line);
+    if (data->bank != -1)
+    {
+        data->hits++;
+        line[data->bank].lastused[SET(*data, data->bank)] = data->access;
+        return 1;
+    }
+    data->misses++;
+
+    // use previously invalid line or oldest
+    data->bank = rep_search(cache->spec, *data, line);
+    if (data->bank == -1)
+    {
+        data->bank = old_search(cache->spec, *data, line);
+        data->victim = line[data->bank].owner[SET(*data, data->bank)];
+    }
+    line[data->bank].valid[SET(*data, data->bank)] = 1;
+    line[data->bank].tag[SET(*data, data->bank)] = data->tag;
+    line[data->bank].lastused[SET(*data, data->bank)] = data->access;
+    line[data->bank].owner[SET(*data, data->bank)] = owner;
+    return 0;
+}
+
+/** sim_cores()
+ *
+ * Purpose: simulates the interleaved references of the cores on their
+ *          private caches, and their private cache misses on the shared
+ *          cache, until the end of every trace.
+ *
+ * Inputs:  spec  - the cache specs data structure
+ *          cores - the simulated cores
+ *          llc   - the shared cache
+ *
+ * Requires:    |cores| = spec.cores;
+ * Ensures:     cores[i].live = 0, for all i;
+ *
+ */
+void sim_cores(struct spec spec, struct core *cores, struct cache *llc)
+{
+    long long accesses = 0;
+    int c = 0;
+    int i;
+    for (;;)
+    {
+        // next core round-robin, or with the oldest timestamp
+        if (spec.order == OTS)
+        {
+            c = -1;
+            for (i=0; i<spec.cores; i++)
+                if (cores[i].live && (c == -1 || cores[i].ref.time < cores[c].ref.time))
+                    c = i;
+            if (c == -1)
+                break;
+        }
+        else
+        {
+            for (i=0; i<spec.cores && !cores[c].live; i++)
+                c = (c+1) % spec.cores;
+            if (!cores[c].live)
+                break;
+        }
+
+        // private cache misses go to the shared cache
+        struct core *core = &cores[c];
+        if (!cache_access(core->l1, core->ref.address, c, ~0u))
+        {
+            if (cache_access(llc, core->ref.address, c, core->mask))
+                core->hits++;
+            else
+            {
+                core->misses++;
+                if (llc->data.victim >= 0 && llc->data.victim != c)
+                {
+                    cores[llc->data.victim].evicted++;
+                    core->evictor++;
+                }
+            }
+            if (spec.ucp)
+            {
+                umon_access(core, llc);
+                if (++accesses % spec.ucp == 0)
+                    ucp_partition(cores, spec.cores, llc->spec.banks);
+            }
+        }
+        core->live = trace_next(&core->trace, &core->ref);
+        if (spec.order == ORR)
+            c = (c+1) % spec.cores;
+    }
+}
+
+/** umon_access()
+ *
+ * Purpose: simulates the last shared cache reference of a core on its UMON,
+ *          a per core LRU tag stack of every UMONS-th set counting the hits
+ *          at each stack position.
+ *
+ * Inputs:  core - the simulated core of the reference
+ *          llc  - the shared cache, after the reference
+ *
+ */
+void umon_access(struct core *core, struct cache *llc)
+{
+    int set = llc->data.index;
+    if (set % UMONS)
+        return;
+    int banks = llc->spec.banks;
+    int *stack = &core->atd[(set/UMONS)*banks];
+    int *depth = &core->depth[set/UMONS];
+    int p;
+    for (p=0; p<*depth; p++)
+        if (stack[p] == llc->data.tag)
+            break;
+    if (p < *depth)
+        core->umon[p]++;
+    else if (*depth < banks)
+        p = (*depth)++;
+    else
+        p = banks-1;
+
+    // move the tag to the MRU position
+    for (; p>0; p--)
+        stack[p] = stack[p-1];
+    stack[0] = llc->data.tag;
+}
+
+/** ucp_partition()
+ *
+ * Purpose: repartitions the shared cache banks between the cores with the
+ *          UCP lookahead algorithm on the UMON hit counters, giving each
+ *          core a contiguous way mask, then halves the counters.
+ *
+ * Inputs:  cores - the simulated cores
+ *          n     - the number of cores
+ *          banks - the shared cache banks
+ *
+ * Requires:    0 < n <= min(banks, 32);
+ * Ensures:     every core has at least one bank; the masks do not overlap;
+ *
+ */
+void ucp_partition(struct core *cores, int n, int banks)
+{
+    int ways = (banks < 32) ? banks : 32;
+    int alloc[CORES];
+    int balance = ways - n;
+    int c, k;
+    for (c=0; c<n; c++)
+        alloc[c] = 1;
+
+    // give the ways with the most hits per way to one core at a time
+    while (balance > 0)
+    {
+        int best = 0;
+        int bestk = 1;
+        double bestmu = -1.0;
+        for (c=0; c<n; c++)
+        {
+            long long gain = 0;
+            for (k=1; k<=balance; k++)
+            {
+                gain += cores[c].umon[alloc[c]+k-1];
+                if ((double) gain/k > bestmu)
+                {
+                    best = c;
+                    bestk = k;
+                    bestmu = (double) gain/k;
+                }
+            }
+        }
+        alloc[best] += bestk;
+        balance -= bestk;
+    }
+
+    int start = 0;
+    for (c=0; c<n; c++)
+    {
+        cores[c].mask = (unsigned int) (((1ULL << alloc[c]) - 1) << start);
+        start += alloc[c];
+        for (k=0; k<banks; k++)
+            cores[c].umon[k] /= 2;
+    }
+}
+
+/** read_trace()
+ *
+ * Purpose: reads a trace file into the ring of chunks of its trace reader,
+ *          waiting while the ring is full, until the end of the file.
+ *
+ * Inputs:  arg - a pointer to the trace reader
+ * Return:  null
+ *
+ * Ensures:     the last chunk filled has fewer than CHUNK references;
+ *
+ */
+void *read_trace(void *arg)
+{
+    struct trace *trace = arg;
+    int tail = 0;
+    int n = 0;
+    do
+    {
+        pthread_mutex_lock(&trace->lock);
+        while (trace->count == QDEPTH)
+            pthread_cond_wait(&trace->cond, &trace->lock);
+        pthread_mutex_unlock(&trace->lock);
+
+        // the merge stage does not use a chunk until it is counted
+        struct chunk *chunk = &trace->chunks[tail];
+        for (n=0; n<CHUNK; n++)
+        {
+            struct ref *ref = &chunk->refs[n];
+            if (trace->order == OTS)
+            {
+                if (fscanf(trace->file, "%llu %x", &ref->time, &ref->address) != 2)
+                    break;
+            }
+            else if (fscanf(trace->file, "%x", &ref->address) != 1)
+                break;
+        }
+        chunk->n = n;
+
+        pthread_mutex_lock(&trace->lock);
+        trace->count++;
+        pthread_cond_broadcast(&trace->cond);
+        pthread_mutex_unlock(&trace->lock);
+        tail = (tail + 1) % QDEPTH;
+    }
+    while (n == CHUNK);
+    fclose(trace->file);
+    return NULL;
+}
+
+/** trace_next()
+ *
+ * Purpose: gets the next reference of a trace, releasing each used chunk to
+ *          the reader thread and waiting for the next one.
+ *
+ * Inputs:  trace - the trace reader
+ *          ref   - a pointer to the reference to set
+ * Return:  1 if there was a next reference, 0 at the end of the trace.
+ *
+ */
+int trace_next(struct trace *trace, struct ref *ref)
+{
+    for (;;)
+    {
+        if (trace->cur != NULL)
+        {
+            if (trace->pos < trace->cur->n)
+            {
+                *ref = trace->cur->refs[trace->pos++];
+                return 1;
+            }
+            if (trace->cur->n < CHUNK)
+                return 0;
+
+            // release the used chunk
+            pthread_mutex_lock(&trace->lock);
+            trace->head = (trace->head + 1) % QDEPTH;
+            trace->count--;
+            pthread_cond_broadcast(&trace->cond);
+            pthread_mutex_unlock(&trace->lock);
+            trace->cur = NULL;
+            trace->pos = 0;
+        }
+
+        // wait for the next chunk
+        pthread_mutex_lock(&trace->lock);
+        while (trace->count == 0)
+            pthread_cond_wait(&trace->cond, &trace->lock);
+        trace->cur = &trace->chunks[trace->head];
+        pthread_mutex_unlock(&trace->lock);
+    }
+}
+
+/** free_cache()
+ *
+ * Purpose: frees a simulated cache.
+ *
+ */
+void free_cache(struct cache *cache)
+{
+    int i;
+    for (i=0; i<cache->spec.banks; i++)
+    {
+        free(cache->line[i].lastused);
+        free(cache->line[i].valid);
+        free(cache->line[i].tag);
+        free(cache->line[i].owner);
+        free(cache->line[i].state);
+        free(cache->line[i].words);
+        free(cache->line[i].present);
+        free(cache->line[i].dirty);
+    }
+    free(cache->line);
+    free(cache->data.sets);
+    free(cache->hash->h3);
+    free(cache->hash);
+    free(cache);
+}
+
+/** free_cores()
+ *
+ * Purpose: frees the simulated cores, joining their trace reader threads.
+ *
+ * Requires:    cores[i].live = 0, for all i;
+ *
+ */
+void free_cores(struct core *cores, int n)
+{
+    int c;
+    for (c=0; c<n; c++)
+    {
+        pthread_join(cores[c].trace.thread, NULL);
+        pthread_mutex_destroy(&cores[c].trace.lock);
+        pthread_cond_destroy(&cores[c].trace.cond);
+        free(cores[c].trace.chunks);
+        free_cache(cores[c].l1);
+        free(cores[c].umon);
+        free(cores[c].atd);
+        free(cores[c].depth);
+    }
+    free(cores);
+}
+
+
+/* -- coherence functions --------------------------------------------------- */
+
+/** coh_access()
+ *
+ * Purpose: simulates a reference of a core on its coherent private cache,
+ *          snooping the other caches on misses and on writes to shared lines,
+ *          and classifying misses to lines invalidated by other cores as
+ *          true or false sharing.
+ *
+ * Inputs:  coh     - the coherent private caches
+ *          core    - the core of the reference
+ *          write   - 1 for a write reference, 0 for a read
+ *          address - the 32-bit address of the reference
+ *
+ * Requires:    0 <= core < coh.n;
+ * Ensures:     at most one cache holds the line in M or E state, and none
+ *              other holds it if so;
+ *
+ */
+void coh_access(struct coherence *coh, int core, int write, int address)
+{
+    struct cache *cache = coh->caches[core];
+    struct data *data = &cache->data;
+    struct line *line = cache->line;
+    unsigned int offset = ((unsigned int) address) & (cache->spec.bytes - 1);
+    unsigned int bit = 1u << (offset >> coh->gshift);
+    data->address = address;
+    data->access++;
+    data->owner = core;
+    hash_address(cache->hash, data);
+    if (write)
+        coh->writes++;
+    else
+        coh->reads++;
+
+    // search for hit, upgrading to M on writes
+    data->bank = hit_search(cache->spec, *data, line);
+    if (data->bank != -1)
+    {
+        int set = SET(*data, data->bank);
+        data->hits++;
+        line[data->bank].lastused[set] = data->access;
+        if (!write)
+            return;
+        unsigned char state = line[data->bank].state[set];
+        if (state != CM)
+        {
+            unsigned int written = 0;
+            if (state == CS || state == CO)
+            {
+                coh->upgrades++;
+                snoop(coh, core, 1, 0, bit, &written);
+            }
+            line[data->bank].state[set] = CM;
+            line[data->bank].words[set] = 0;
+        }
+        line[data->bank].words[set] |= bit;
+        return;
+    }
+    data->misses++;
+
+    // a line invalidated by another core is a coherence miss, false sharing
+    // if no other core wrote the granule since
+    int stale = inv_search(cache->spec, *data, line);
+    unsigned int written = 0;
+    if (stale != -1)
+        written = line[stale].words[SET(*data, stale)];
+    int shared = snoop(coh, core, write, 1, bit, &written);
+    if (stale != -1)
+    {
+        coh->coherence++;
+        if (!(written & bit))
+        {
+            coh->falses++;
+            fs_record(coh, ((unsigned int) address) & ~(cache->spec.bytes - 1));
+        }
+    }
+
+    // refill the stale line, or use previously invalid line or oldest,
+    // writing back M or O lines
+    data->bank = (stale != -1) ? stale : rep_search(cache->spec, *data, line);
+    if (data->bank == -1)
+    {
+        data->bank = old_search(cache->spec, *data, line);
+        unsigned char state = line[data->bank].state[SET(*data, data->bank)];
+        if (state == CM || state == CO)
+            coh->writebacks++;
+    }
+    int set = SET(*data, data->bank);
+    line[data->bank].valid[set] = 1;
+    line[data->bank].tag[set] = data->tag;
+    line[data->bank].lastused[set] = data->access;
+    line[data->bank].owner[set] = core;
+    line[data->bank].state[set] = write ? CM : (shared ? CS : CE);
+    line[data->bank].words[set] = write ? bit : 0;
+}
+
+/** snoop()
+ *
+ * Purpose: snoops the other caches for the line of the current reference of
+ *          a core, invalidating their copies on a write, or downgrading
+ *          them to S (or M to O, if MOESI) on a read.
+ *
+ * Inputs:  coh     - the coherent private caches
+ *          core    - the core of the reference
+ *          write   - 1 for a write (BusRdX or upgrade), 0 for a read (BusRd)
+ *          miss    - 1 for a miss (BusRd or BusRdX), 0 for an upgrade
+ *          bit     - the granule of the reference
+ *          written - a pointer to the granules written by other cores, to
+ *                    add the written granules of each copy to
+ * Return:  1 if another cache held a copy of the line, otherwise 0.
+ *
+ */
+int snoop(struct coherence *coh, int core, int write, int miss,
+        unsigned int bit, unsigned int *written)
+{
+    struct data probe = coh->caches[core]->data;
+    int shared = 0;
+    int k;
+    for (k=0; k<coh->n; k++)
+    {
+        if (k == core)
+            continue;
+        struct cache *other = coh->caches[k];
+        int bank = hit_search(other->spec, probe, other->line);
+        if (bank == -1)
+            continue;
+        int set = SET(probe, bank);
+        unsigned char state = other->line[bank].state[set];
+        shared = 1;
+        *written |= other->line[bank].words[set];
+
+        // an M or O copy supplies the data, unless the requester has it
+        if ((state == CM || state == CO) && miss)
+            coh->interventions++;
+
+        if (write)
+        {
+            // the line keeps its tag as a record of the invalidating write
+            other->line[bank].valid[set] = 0;
+            other->line[bank].state[set] = CI;
+            other->line[bank].words[set] = bit;
+            coh->invalidations++;
+        }
+        else if (state == CM && coh->protocol == CMOESI)
+            other->line[bank].state[set] = CO;
+        else if (state == CM)
+        {
+            other->line[bank].state[set] = CS;
+            coh->writebacks++;
+        }
+        else if (state == CE)
+            other->line[bank].state[set] = CS;
+    }
+    return shared;
+}
+
+/** fs_record()
+ *
+ * Purpose: counts a false sharing miss of a line in the false sharing table,
+ *          doubling the table before it is half full.
+ *
+ * Inputs:  coh   - the coherent private caches
+ *          block - the address of the line
+ *
+ */
+void fs_record(struct coherence *coh, unsigned int block)
+{
+    int i, slot;
+    if (2*(coh->count + 1) > coh->capacity)
+    {
+        unsigned int *blocks = coh->fsblock;
+        long long *counts = coh->fscount;
+        int capacity = coh->capacity;
+        coh->capacity *= 2;
+        coh->fsblock = calloc(coh->capacity, sizeof(unsigned int));
+        coh->fscount = calloc(coh->capacity, sizeof(long long));
+        if (coh->fsblock == NULL || coh->fscount == NULL)
+        {
+            printf("ERROR! Failed to allocate table of size %d.\n",
+                    coh->capacity);
+            exit(-1);
+        }
+        for (i=0; i<capacity; i++)
+        {
+            if (counts[i] == 0)
+                continue;
+            slot = fs_find(coh, blocks[i]);
+            coh->fsblock[slot] = blocks[i];
+            coh->fscount[slot] = counts[i];
+        }
+        free(blocks);
+        free(counts);
+    }
+
+    slot = fs_find(coh, block);
+    if (coh->fscount[slot] == 0)
+    {
+        coh->fsblock[slot] = block;
+        coh->count++;
+    }
+    coh->fscount[slot]++;
+}
+
+/** fs_find()
+ *
+ * Purpose: returns the false sharing table slot of the specified line, or
+ *          the empty slot to insert it in.
+ *
+ * Inputs:  coh   - the coherent private caches
+ *          block - the address of the line
+ * Return:  the table slot of the line, or an empty slot.
+ *
+ * Requires:    coh.count < coh.capacity;
+ *
+ */
+int fs_find(struct coherence *coh, unsigned int block)
+{
+    int slot = mix_hash(block) & (coh->capacity - 1);
+    while (coh->fscount[slot] > 0 && coh->fsblock[slot] != block)
+        slot = (slot + 1) & (coh->capacity - 1);
+    return slot;
+}
+
+/** free_coherence()
+ *
+ * Purpose: frees the coherent private caches.
+ *
+ */
+void free_coherence(struct coherence *coh)
+{
+    int c;
+    for (c=0; c<coh->n; c++)
+        free_cache(coh->caches[c]);
+    free(coh->caches);
+    free(coh->fsblock);
+    free(coh->fscount);
+    free(coh);
+}
+
+
+/* -- sector functions ------------------------------------------------------ */
+
+/** sec_search()
+ *
+ * Purpose: searches the line of a tag hit for the sector of the address,
+ *          filling it on a sector miss.
+ *
+ * Inputs:  data - a pointer to the cache simulation data, after a tag hit
+ *          line - the cache line arrays, with sector masks
+ * Return:  1 if the sector was valid, 0 for a sector miss.
+ *
+ * Requires:    data.bank != -1;
+ * Ensures:     present[set] & data.sector != 0;
+ *
+ */
+int sec_search(struct data *data, struct line *line)
+{
+    int set = SET(*data, data->bank);
+    if (line[data->bank].present[set] & data->sector)
+        return 1;
+    data->sectors++;
+    line[data->bank].present[set] |= data->sector;
+    return 0;
+}
+
+/** sec_fill()
+ *
+ * Purpose: fills the sector of the address into a replaced line, writing
+ *          back the dirty sectors of the line it replaces.
+ *
+ * Inputs:  data - a pointer to the cache simulation data, after a tag miss
+ *          line - the cache line arrays, with sector masks
+ *
+ * Requires:    data.bank is the replaced line, before its valid bit is set;
+ * Ensures:     present[set] = data.sector; dirty[set] = 0;
+ *
+ */
+void sec_fill(struct data *data, struct line *line)
+{
+    int set = SET(*data, data->bank);
+    unsigned int dirty = line[data->bank].valid[set] ?
+        line[data->bank].dirty[set] : 0;
+    for (; dirty; dirty &= dirty - 1)
+        data->writebacks++;
+    line[data->bank].present[set] = data->sector;
+    line[data->bank].dirty[set] = 0;
+}
+
+/** sec_write()
+ *
+ * Purpose: marks the sector of the address dirty.
+ *
+ * Inputs:  data - a pointer to the cache simulation data, after the access
+ *          line - the cache line arrays, with sector masks
+ *
+ */
+void sec_write(struct data *data, struct line *line)
+{
+    line[data->bank].dirty[SET(*data, data->bank)] |= data->sector;
+}
+
+/** read_rw()
+ *
+ * Purpose: reads the optional read/write flag following an address on the
+ *          standard input, i.e.: "0000202c w".
+ *
+ * Return:  1 for a write flag, 0 for a read flag or none.
+ *
+ */
+int read_rw(void)
+{
+    int c = getchar();
+    while (c == ' ' || c == '\t')
+        c = getchar();
+    if (c == 'w' || c == 'W')
+        return 1;
+    if (c != 'r' && c != 'R' && c != EOF)
+        ungetc(c, stdin);
+    return 0;
+}
+
+
+/* -- timing functions ------------------------------------------------------ */
+
+/** tim_access()
+ *
+ * Purpose: times a reference issued after the previous one, given its hit or
+ *          miss on the cache. A miss allocates an MSHR, waiting for the
+ *          earliest fill if all are busy, and its fill waits for the next
+ *          level bandwidth. A hit to a line with an outstanding fill merges
+ *          into its MSHR. Only misses and hits during fills scan the MSHRs.
+ *
+ * Inputs:  tim     - the timing data
+ *          hit     - 1 if the reference hit the cache, otherwise 0
+ *          address - the 32-bit address of the reference
+ *
+ * Requires:    tim != null;
+ * Ensures:     tim.now is the issue time of the next reference;
+ *
+ */
+void tim_access(struct timing *tim, int hit, int address)
+{
+    unsigned int block = ((unsigned int) address) >> tim->shift;
+    long long issued = tim->now;
+    long long latency = tim->hitlat;
+    int i;
+    tim->refs++;
+
+    if (hit)
+    {
+        // a secondary miss waits for the outstanding fill of its line
+        if (tim->now < tim->horizon)
+        {
+            for (i=0; i<tim->mshrs; i++)
+            {
+                if (tim->ready[i] > tim->now && tim->block[i] == block)
+                {
+                    tim->secondary++;
+                    if (tim->ready[i] - tim->now > latency)
+                        latency = tim->ready[i] - tim->now;
+                    break;
+                }
+            }
+        }
+    }
+    else
+    {
+        // a free MSHR, or the earliest to fill if all are busy
+        int mshr = 0;
+        for (i=1; i<tim->mshrs; i++)
+            if (tim->ready[i] < tim->ready[mshr])
+                mshr = i;
+        if (tim->ready[mshr] > tim->now)
+        {
+            tim->full++;
+            tim->stall += tim->ready[mshr] - tim->now;
+            tim->now = tim->ready[mshr];
+        }
+
+        // the fill returns after the miss latency and its next level transfer
+        long long ready = tim->now + tim->misslat;
+        if (tim->xfer > 0)
+        {
+            if (tim->bus + tim->xfer > ready)
+                ready = tim->bus + tim->xfer;
+            tim->bus = ready;
+        }
+        tim->primary++;
+        tim->block[mshr] = block;
+        tim->ready[mshr] = ready;
+        if (ready > tim->horizon)
+            tim->horizon = ready;
+
+        // outstanding miss cycles, and their union for the MLP
+        tim->misstime += ready - tim->now;
+        if (tim->now >= tim->busyend)
+            tim->busy += ready - tim->now;
+        else if (ready > tim->busyend)
+            tim->busy += ready - tim->busyend;
+        if (ready > tim->busyend)
+            tim->busyend = ready;
+        latency = ready - issued;
+    }
+    tim->latency += latency;
+    tim->now += tim->issue;
+}
+
+/** free_timing()
+ *
+ * Purpose: frees the non-blocking cache timing data.
+ *
+ */
+void free_timing(struct timing *tim)
+{
+    free(tim->block);
+    free(tim->ready);
+    free(tim);
+}
+
+
+/* -- miscellaneous math -- */
+
+/** pow_2()
+ *
+ * Purpose: returns the value of 2 raised to the specified power.
+ *
+ * Inputs:  power - the power exponent to raise 2 to
+ * Return:  the value of 2 raised to the power
+ *
+ * Requires:    power >= 0;
+ * Ensures:     result = 2^power;
+ *
+ */
+int pow_2(int power)
+{
+    if (power < 0)
+        return -1;
+    int result = 1;
+    int i=0;
+    for (i=0; i<power; i++)
+        result *= 2;
+    return result;
+}
+
+/** log_2()
+ *
+ * Purpose: returns the log base 2 of the specified value.
+ *
+ * Inputs:  value - the value to take the log base 2 of
+ * Return:  the log base 2 of the value
+ *
+ * Requires:    value > 0; value mod 2 = 0 or value = 1;
+ * Ensures:     result = log_2(value);
+ *
+ */
+int log_2(int value)
+{
+    if (value < 1)
+        return -1;
+    int result = value/2;
+    int i=0;
+    while (result > 0)
+    {
+        result /= 2;
+        i++;
+    }
+    return i;
+}
+
+/** prime_floor()
+ *
+ * Purpose: returns the largest prime number less than or equal to the
+ *          specified value.
+ *
+ * Inputs:  value - the upper bound of the prime
+ * Return:  the largest prime <= value, or 1 if value < 2
+ *
+ * Requires:    value > 0;
+ * Ensures:     result is prime and result <= value, or result = 1;
+ *
+ */
+int prime_floor(int value)
+{
+    int i;
+    for (; value > 2; value--)
+    {
+        for (i=2; i*i <= value; i++)
+            if (value % i == 0)
+                break;
+        if (i*i > value)
+            return value;
+    }
+    return value;
+}
 
 /* -- printer functions ----------------------------------------------------- */
 
@@ -403,7 +2819,51 @@ void print_stats(int hits, int misses)
     printf("references:\t%d\n", hits + misses);
     printf("hits:\t\t%d\n", hits);
     printf("misses:\t\t%d\n", misses);
-    printf("hit rate:\t%-5.2f%%\n\n", ((float) (hits/(hits + misses)))*100.0);
+    printf("hit rate:\t%-5.2f%%\n\n", ((float) hits/(hits + misses))*100.0);
+}
+
+/** print_prof()
+ *
+ * Purpose: prints the estimated time of each profiled phase, the run rates,
+ *          and the host hardware counters to stdout.
+ *
+ * Inputs:  prof - the self-profiling data of a stopped run
+ *
+ * Requires:    prof != null; prof.refs > 0;
+ *
+ */
+void print_prof(struct prof *prof)
+{
+    const char *phases[PHASES] = {"trace parse", "index/tag", "hit_search",
+        "victim", "output"};
+    const char *perfs[PERFS] = {"cycles", "instructions", "LLC misses",
+        "branch misses"};
+    double ns = (prof->stop > prof->start) ?
+        prof->wall/(prof->stop - prof->start) : 0.0;
+    double scale = (prof->samples > 0) ? (double) prof->refs/prof->samples : 0.0;
+    int i;
+
+    printf("profile:\n\n");
+    for (i=0; i<PHASES; i++)
+    {
+        double phase = prof->ticks[i]*scale*ns;
+        printf("%-14s\t%10.3f ms\t%5.1f%%\t%8.1f ns/ref\n", phases[i],
+                phase/1e6, (prof->wall > 0) ? 100.0*phase/prof->wall : 0.0,
+                phase/prof->refs);
+    }
+    printf("\nwall time:\t%10.3f ms\n", prof->wall/1e6);
+    printf("refs/second:\t%10.0f\n", prof->refs/(prof->wall/1e9));
+    printf("ns/reference:\t%10.1f\n\n", prof->wall/prof->refs);
+    for (i=0; i<PERFS; i++)
+    {
+        if (prof->fds[i] < 0 || prof->counts[i] < 0)
+            printf("%-14s\t%14s\n", perfs[i], "n/a");
+        else
+            printf("%-14s\t%14lld\n", perfs[i], prof->counts[i]);
+    }
+    if (prof->fds[0] >= 0 && prof->fds[1] >= 0 && prof->counts[0] > 0)
+        printf("IPC:\t\t%14.2f\n", (double) prof->counts[1]/prof->counts[0]);
+    printf("\n");
 }
 
 /** print_spec()
@@ -425,6 +2885,211 @@ void print_spec(struct spec spec)
     printf("bit offset:\t%3d\n\n", spec.offset);
 }
 
+/** print_hash()
+ *
+ * Purpose: prints the set index function to stdout.
+ *
+ * Inputs:  hash - the set index function data
+ *
+ * Requires:    hash != null;
+ *
+ */
+void print_hash(struct hash *hash)
+{
+    const char *names[] = {"bit-select", "xor-fold", "H3", "modulo",
+        "prime modulo", "skewed H3"};
+    printf("index function:\t%s\n", names[hash->mode]);
+    printf("indexed sets:\t%3u\n\n", hash->sets);
+}
+
+/** print_mrc()
+ *
+ * Purpose: prints the approximate miss ratio curve of a fully-associative
+ *          LRU cache to stdout, for each cache size up to the largest reuse
+ *          distance. A sampled curve starts at MRCK sampling intervals and
+ *          needs MRCS sampled blocks at a fixed rate, as the hotness of the
+ *          few sampled blocks skews the smaller sizes and smaller samples.
+ *
+ * Inputs:  mrc   - the sampled reuse distance data
+ *          bytes - the line size (in bytes)
+ *
+ * Requires:    mrc != null; mrc.refs > 0;
+ *
+ */
+void print_mrc(struct mrc *mrc, int bytes)
+{
+    // the unsampled references adjust the shortest reuse distances
+    double sampled = mrc->cold;
+    int last = 0;
+    int i;
+    for (i=0; i<MRCB; i++)
+    {
+        sampled += mrc->hist[i];
+        if (mrc->hist[i] > 0.0)
+            last = i;
+    }
+    double hits = mrc->refs - sampled;
+    double interval = (double) MRCP/mrc->threshold;
+    double smallest = (mrc->threshold < MRCP) ? MRCK*interval : 1.0;
+
+    printf("references:\t%lld\n", mrc->refs);
+    printf("sampled blocks:\t%d\n", mrc->count);
+    printf("sampling rate:\t1/%.1f\n", interval);
+    if (mrc->threshold < MRCP && mrc->max == 0 && mrc->count < MRCS)
+    {
+        printf("\ntoo few sampled blocks for an accurate curve (< %d),\n", MRCS);
+        printf("lower the sampling rate (-r) or bound the blocks (-m).\n\n");
+        return;
+    }
+    printf("smallest size:\t%.0f lines\n\n", smallest);
+    printf("%12s %12s %12s\n", "size [KB]", "lines", "miss ratio");
+    for (i=1; i<=last+1; i++)
+    {
+        hits += mrc->hist[i-1];
+        if (mrc_size(i) < smallest)
+            continue;
+        double ratio = 1.0 - hits/mrc->refs;
+        ratio = (ratio < 0.0) ? 0.0 : (ratio > 1.0) ? 1.0 : ratio;
+        printf("%12.2f %12llu %12.4f\n", (double) mrc_size(i)*bytes/KB,
+                mrc_size(i), ratio);
+    }
+    printf("\n");
+}
+
+/** print_cores()
+ *
+ * Purpose: prints the private and shared cache hit rates, the inter-core
+ *          evictions, and the shared cache way mask of each core to stdout.
+ *
+ * Inputs:  cores - the simulated cores
+ *          n     - the number of cores
+ *          llc   - the shared cache
+ *
+ */
+void print_cores(struct core *cores, int n, struct cache *llc)
+{
+    int c;
+    printf("%-4s %12s %8s %12s %8s %10s %10s %10s  %s\n", "core", "refs",
+            "L1 hit", "LLC refs", "LLC hit", "evicted", "evictor", "mask",
+            "trace");
+    for (c=0; c<n; c++)
+    {
+        struct core *core = &cores[c];
+        long long refs = core->l1->data.hits + core->l1->data.misses;
+        long long llc_refs = core->hits + core->misses;
+        printf("%-4d %12lld %7.2f%% %12lld %7.2f%% %10lld %10lld 0x%08x  %s\n",
+                c, refs, (refs > 0) ? 100.0*core->l1->data.hits/refs : 0.0,
+                llc_refs, (llc_refs > 0) ? 100.0*core->hits/llc_refs : 0.0,
+                core->evicted, core->evictor, core->mask, core->name);
+    }
+    printf("\nshared cache hit rate:\n\n");
+    print_stats(llc->data.hits, llc->data.misses);
+}
+
+/** print_coherence()
+ *
+ * Purpose: prints the hit rate of each coherent cache, the coherence
+ *          traffic, and the lines with the most false sharing misses to
+ *          stdout.
+ *
+ * Inputs:  coh - the coherent private caches
+ *
+ */
+void print_coherence(struct coherence *coh)
+{
+    int c, i, k;
+    printf("%-4s %12s %12s %12s %8s\n", "core", "refs", "hits", "misses",
+            "hit");
+    for (c=0; c<coh->n; c++)
+    {
+        struct data *data = &coh->caches[c]->data;
+        long long refs = (long long) data->hits + data->misses;
+        printf("%-4d %12lld %12d %12d %7.2f%%\n", c, refs, data->hits,
+                data->misses, (refs > 0) ? 100.0*data->hits/refs : 0.0);
+    }
+    printf("\nreads:\t\t\t%12lld\n", coh->reads);
+    printf("writes:\t\t\t%12lld\n", coh->writes);
+    printf("upgrades:\t\t%12lld\n", coh->upgrades);
+    printf("invalidations:\t\t%12lld\n", coh->invalidations);
+    printf("interventions:\t\t%12lld\n", coh->interventions);
+    printf("writebacks:\t\t%12lld\n", coh->writebacks);
+    printf("coherence misses:\t%12lld\n", coh->coherence);
+    printf("  true sharing:\t\t%12lld\n", coh->coherence - coh->falses);
+    printf("  false sharing:\t%12lld\n\n", coh->falses);
+
+    // the FSTOP lines with the most false sharing misses, most first
+    printf("false sharing lines:\t%12d\n\n", coh->count);
+    long long last = -1;
+    unsigned int lastblock = 0;
+    for (k=0; k<FSTOP && k<coh->count; k++)
+    {
+        int top = -1;
+        for (i=0; i<coh->capacity; i++)
+        {
+            long long n = coh->fscount[i];
+            unsigned int block = coh->fsblock[i];
+            if (n == 0 || (last >= 0 && (n > last
+                            || (n == last && block >= lastblock))))
+                continue;
+            if (top == -1 || n > coh->fscount[top]
+                    || (n == coh->fscount[top] && block > coh->fsblock[top]))
+                top = i;
+        }
+        last = coh->fscount[top];
+        lastblock = coh->fsblock[top];
+        printf("    0x%08x\t%12lld\n", lastblock, last);
+    }
+    printf("\n");
+}
+
+/** print_timing()
+ *
+ * Purpose: prints the cycles, average latency, memory-level parallelism,
+ *          and MSHR stalls of the timed references to stdout.
+ *
+ * Inputs:  tim - the timing data
+ *
+ * Requires:    tim.refs > 0;
+ *
+ */
+void print_timing(struct timing *tim)
+{
+    long long last = tim->now - tim->issue;
+    long long cycles = (tim->horizon > last) ? tim->horizon : last;
+    printf("cycles:\t\t\t%12lld\n", cycles);
+    printf("average latency:\t%12.2f\n", (double) tim->latency/tim->refs);
+    printf("MLP:\t\t\t%12.2f\n",
+            (tim->busy > 0) ? (double) tim->misstime/tim->busy : 0.0);
+    printf("stall cycles:\t\t%12lld\n", tim->stall);
+    printf("primary misses:\t\t%12lld\n", tim->primary);
+    printf("secondary misses:\t%12lld\n", tim->secondary);
+    printf("MSHRs full:\t\t%12lld\n", tim->full);
+    if (tim->xfer > 0 && cycles > 0)
+        printf("bus utilization:\t%11.2f%%\n",
+                100.0*tim->primary*tim->xfer/cycles);
+    printf("\n");
+}
+
+/** print_sectors()
+ *
+ * Purpose: prints the tag misses, sector misses, bytes fetched, and bytes
+ *          written back of a sectored cache to stdout.
+ *
+ * Inputs:  spec - the cache specs data structure
+ *          data - the cache simulation data
+ *
+ * Requires:    spec.sector > 0;
+ *
+ */
+void print_sectors(struct spec spec, struct data data)
+{
+    printf("sector size:\t%12d\n", spec.sector);
+    printf("tag misses:\t%12d\n", data.misses - data.sectors);
+    printf("sector misses:\t%12d\n", data.sectors);
+    printf("bytes fetched:\t%12lld\n", (long long) data.misses*spec.sector);
+    printf("bytes written:\t%12lld\n\n", data.writebacks*spec.sector);
+}
+
 /** print_data()
  *
  * Purpose: prints the specified cache data to stdout.
@@ -457,6 +3122,26 @@ void print_usage(void)
     printf("\t-s  - to specify the cache size (in KB)\n");
     printf("\t-b  - to specify the number of blocks\n");
     printf("\t-l  - to specify the line size (in B)\n");
+    printf("\t-i  - to specify the set index function, one of:\n");
+    printf("\t      bit, xor, h3, mod, prime, skew\n");
+    printf("\t-k  - to specify the hash matrix seed (h3, skew)\n");
+    printf("\t-r  - to print the miss ratio curve sampling 1/r blocks\n");
+    printf("\t-m  - to specify the max sampled blocks of the curve\n");
+    printf("\t--profile - to print the time of each simulation phase\n");
+    printf("\t-t  - to specify the trace file of a core (repeatable)\n");
+    printf("\t-S  - to specify the shared cache size (in KB)\n");
+    printf("\t-B  - to specify the number of shared cache banks\n");
+    printf("\t-w  - to specify the shared cache way mask of a core (hex)\n");
+    printf("\t-u  - to repartition the shared cache every u accesses\n");
+    printf("\t-o  - to interleave the cores by rr or ts (timestamp)\n");
+    printf("\t-c  - to simulate coherent caches by mesi or moesi\n");
+    printf("\t-n  - to specify the number of coherent cores\n");
+    printf("\t-Q  - to time the references with Q MSHRs\n");
+    printf("\t-H  - to specify the hit latency (in cycles)\n");
+    printf("\t-M  - to specify the miss latency (in cycles)\n");
+    printf("\t-W  - to specify the next level bandwidth (in B/cycle)\n");
+    printf("\t-I  - to specify the cycles between references\n");
+    printf("\t-e  - to specify the sector size (in B) of the lines\n");
     printf("and <filename> is the name of the input file.\n\n");
     printf("Example:\t./cache-sim -16 < sc10k\n\n");
     printf("\tThis example will simulate a simple 8-way set-associative");
@@ -492,6 +3177,92 @@ void print_error(int mode, char *argv)
             printf("ERROR! Invalid line size (%s).\n\n", argv);
             break;
         }
+        case 3:
+        {
+            printf("ERROR! Invalid index function (%s).\n\n", argv);
+            break;
+        }
+        case 4:
+        {
+            printf("ERROR! Invalid hash seed (%s).\n\n", argv);
+            break;
+        }
+        case 5:
+        {
+            printf("ERROR! Invalid sampling rate (%s).\n\n", argv);
+            break;
+        }
+        case 6:
+        {
+            printf("ERROR! Invalid number of sampled blocks (%s).\n\n", argv);
+            break;
+        }
+        case 7:
+        {
+            printf("ERROR! Invalid trace file (%s).\n\n", argv);
+            break;
+        }
+        case 8:
+        {
+            printf("ERROR! Invalid way mask (%s).\n\n", argv);
+            break;
+        }
+        case 9:
+        {
+            printf("ERROR! Invalid core interleaving (%s).\n\n", argv);
+            break;
+        }
+        case 10:
+        {
+            printf("ERROR! Invalid repartition interval (%s).\n\n", argv);
+            break;
+        }
+        case 11:
+        {
+            printf("ERROR! Invalid coherence protocol (%s).\n\n", argv);
+            break;
+        }
+        case 12:
+        {
+            printf("ERROR! Invalid number of cores (%s).\n\n", argv);
+            break;
+        }
+        case 13:
+        {
+            printf("ERROR! Invalid number of MSHRs (%s).\n\n", argv);
+            break;
+        }
+        case 14:
+        {
+            printf("ERROR! Invalid latency (%s).\n\n", argv);
+            break;
+        }
+        case 15:
+        {
+            printf("ERROR! Invalid bandwidth (%s).\n\n", argv);
+            break;
+        }
+        case 16:
+        {
+            printf("ERROR! Invalid issue interval (%s).\n\n", argv);
+            break;
+        }
+        case 17:
+        {
+            printf("ERROR! Invalid sector size (%s).\n\n", argv);
+            break;
+        }
+        case 18:
+        {
+            printf("ERROR! Invalid option with -t, -c or -r (%s).\n\n", argv);
+            break;
+        }
+        case 19:
+        {
+            printf("ERROR! Too many trace files, at most %d cores (%s).\n\n",
+                    CORES, argv);
+            break;
+        }
         default:
         {
             printf("ERROR! Invalid command line argument (%s).\n\n", argv);
@@ -0,0 +1,59 @@
+#!/bin/sh
+# mrc-check.sh - checks the sampled miss ratio curve of cache-sim.c
+#
+# Usage:    ./mrc-check.sh [<filename> [<rate> [<line-size>]]]
+#
+# Compares the exact miss ratio curve (-r 1) against the set simulator
+# configured fully-associative (-b <lines>, one line per bank) for cache
+# sizes of 16 to 1024 lines, then the sampled curve (-r <rate>) against
+# the exact curve at every size it prints. Exits with status 1 if any
+# miss ratio is off by more than 0.01.
+#
+# Defaults: sc10k.txt, rate 10, 64 byte lines.
+
+trace=${1:-sc10k.txt}
+rate=${2:-10}
+bytes=${3:-64}
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+sim=$dir/cache-sim
+exact=$dir/exact.txt
+sampled=$dir/sampled.txt
+
+gcc -Wall -O2 "$(dirname "$0")/cache-sim.c" -o $sim -pthread || exit 1
+$sim -l $bytes -r 1 < $trace > $exact
+$sim -l $bytes -r $rate < $trace > $sampled
+
+# the curves are flat between the printed sizes and past the last one
+curve()
+{
+    awk -v n=$1 'NF == 3 && $2+0 > 0 && $2 <= n {r=$3} END {print r}' $2
+}
+
+failed=0
+printf "%8s %12s %12s %10s\n" "lines" "simulator" "exact" "error"
+for lines in 16 32 64 128 256 512 1024
+do
+    kb=$((lines*bytes/1024))
+    [ $kb -lt 1 ] && continue
+    ratio=$($sim -s $kb -b $lines -l $bytes < $trace |
+        awk '/^references:/ {r=$2} /^misses:/ {m=$2} END {printf "%.4f", m/r}')
+    ratio1=$(curve $lines $exact)
+    error=$(awk -v a="$ratio" -v b="$ratio1" 'BEGIN {printf "%.4f", b-a}')
+    printf "%8d %12s %12s %10s\n" $lines "$ratio" "$ratio1" "$error"
+    awk -v e="$error" 'BEGIN {exit !(e > 0.01 || e < -0.01)}' && failed=1
+done
+
+printf "\n%8s %12s %12s %10s\n" "lines" "exact" "sampled" "error"
+for lines in $(awk 'NF == 3 && $2+0 > 0 {print $2}' $sampled)
+do
+    ratio1=$(curve $lines $exact)
+    ratio=$(curve $lines $sampled)
+    error=$(awk -v a="$ratio1" -v b="$ratio" 'BEGIN {printf "%.4f", b-a}')
+    printf "%8d %12s %12s %10s\n" $lines "$ratio1" "$ratio" "$error"
+    awk -v e="$error" 'BEGIN {exit !(e > 0.01 || e < -0.01)}' && failed=1
+done
+grep "too few" $sampled
+[ $failed -eq 0 ] && printf "\nmiss ratios within 0.01\n" ||
+    printf "\nmiss ratios off by more than 0.01\n"
+exit $failed